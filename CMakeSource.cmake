@@ -1,8 +1,44 @@
 target_sources(Genesis PUBLIC 
     # AST COMPONENTS
     "${Genesis.INCLUDE}/AST/Lexer.hpp"
+    "${Genesis.INCLUDE}/AST/ParallelLexer.hpp"
     "${Genesis.INCLUDE}/AST/TokenClass.hpp"
+    "${Genesis.INCLUDE}/AST/Keywords.hpp"
+    "${Genesis.INCLUDE}/AST/Operators.hpp"
+    "${Genesis.INCLUDE}/AST/StaticLexer.hpp"
+    "${Genesis.INCLUDE}/AST/CharClass.hpp"
+    "${Genesis.INCLUDE}/AST/Scanner.hpp"
+    "${Genesis.INCLUDE}/AST/ScannerKernels.hpp"
+    "${Genesis.INCLUDE}/AST/TokenStatement.hpp"
+    "${Genesis.INCLUDE}/AST/TokenStream.hpp"
+    "${Genesis.INCLUDE}/AST/TokenStore.hpp"
+    "${Genesis.INCLUDE}/AST/Diagnostics.hpp"
+    "${Genesis.INCLUDE}/AST/LineIndex.hpp"
+    "${Genesis.INCLUDE}/AST/Traversal.hpp"
+    "${Genesis.INCLUDE}/AST/Parser.hpp"
+    "${Genesis.INCLUDE}/AST/Pipeline.hpp"
+    "${Genesis.INCLUDE}/AST/Incremental.hpp"
+    "${Genesis.INCLUDE}/AST/Optimizer.hpp"
+    "${Genesis.INCLUDE}/AST/TreeCache.hpp"
+
+    # VM COMPONENTS
+    "${Genesis.INCLUDE}/VM/Value.hpp"
+    "${Genesis.INCLUDE}/VM/Chunk.hpp"
+    "${Genesis.INCLUDE}/VM/Compiler.hpp"
+    "${Genesis.INCLUDE}/VM/VM.hpp"
+
+    # DRIVER COMPONENTS
+    "${Genesis.INCLUDE}/Driver/ThreadPool.hpp"
+    "${Genesis.INCLUDE}/Driver/Driver.hpp"
+    "${Genesis.INCLUDE}/Driver/Server.hpp"
 
     # OTHER COMPONENTS
     "${Genesis.INCLUDE}/Util/Source.hpp"
+    "${Genesis.INCLUDE}/Util/Arena.hpp"
+    "${Genesis.INCLUDE}/Util/SourceBuffer.hpp"
+    "${Genesis.INCLUDE}/Util/Hash.hpp"
+    "${Genesis.INCLUDE}/Util/Symbols.hpp"
+    "${Genesis.INCLUDE}/Util/Stats.hpp"
+    "${Genesis.INCLUDE}/Util/OutputBuffer.hpp"
+    "${Genesis.INCLUDE}/Util/SpscQueue.hpp"
 )
\ No newline at end of file
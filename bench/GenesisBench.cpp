@@ -0,0 +1,605 @@
+#include "../include/AST/Incremental.hpp"
+#include "../include/AST/Pipeline.hpp"
+#include "../include/AST/ParallelLexer.hpp"
+#include "../include/AST/Optimizer.hpp"
+#include "../include/AST/StaticLexer.hpp"
+#include "../include/VM/Compiler.hpp"
+#include "../include/Util/SourceBuffer.hpp"
+#include "./SourceGenerator.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <sys/resource.h>
+
+// Lexer / Parser / toString / end-to-end throughput on generated sources, reported as JSON.
+//
+//   genesis_bench [--shape mixed|deep|identifiers|comments|strings|keywords|numbers|all] [--size MB]
+//                 [--iterations N] [--seed N] [--depth N] [--max-nesting N] [--output file.json]
+//
+// Every phase runs `iterations` times and the fastest run is reported. The nesting section parses,
+// walks, prints, optimizes and compiles single statements nested 100, 1000, ... up to
+// --max-nesting levels deep (0 skips it), time per level should stay flat. The snippet section
+// compares lexing an embedded snippet at startup with taking its tokens from genesis::lex().
+
+struct BenchOptions {
+    std::vector<SourceShape> shapes;
+    double megabytes = 4;
+    int iterations = 5;
+    uint64_t seed = 0x5eed;
+    int depth = 64;
+    size_t maxNesting = 1000000;
+    std::string output;
+};
+
+struct PhaseResult {
+    double seconds = 0;
+    size_t bytes = 0, tokens = 0, nodes = 0;
+};
+
+long peakResidentKilobytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+volatile size_t benchSink = 0;
+
+// Every operator new in the process is counted, so a phase can report how often it hit the heap.
+// All replaceable forms are defined so every delete matches the new it pairs with.
+std::atomic<size_t> heapAllocations { 0 };
+
+void* countedAllocate(size_t size, size_t alignment) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (size == 0)
+        size = 1;
+
+    if (alignment <= alignof(std::max_align_t))
+        return std::malloc(size);
+
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* countedAllocateOrThrow(size_t size, size_t alignment) {
+    if (void* memory = countedAllocate(size, alignment))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+
+template <typename Function>
+double fastest(int iterations, Function function) {
+    double best = 1e300;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        best = std::min(best, elapsed.count());
+    }
+
+    return best;
+}
+
+// Full-tree walk folding every node into a checksum, with the same visits dispatched through the
+// virtual Visit interface or statically through the kind tag
+template <bool Static>
+class NodeSum final : public Visit, public StaticVisit<NodeSum<Static>> {
+private:
+    std::vector<Statement*> pending;
+
+public:
+    uint64_t sum = 0;
+
+    void visit(Expression&) {}
+    void visit(LiteralValue& node) { sum += node.token.value.size(); }
+    void visit(Binary& node) { sum += static_cast<uint64_t>(node.op.token); pending.push_back(node.right); pending.push_back(node.left); }
+    void visit(Unary& node) { sum += static_cast<uint64_t>(node.op.token); pending.push_back(node.right); }
+    void visit(Grouping& node) { sum++; pending.push_back(node.expression); }
+    void visit(Let& node) { sum += node.name.value.size(); pending.push_back(node.initializer); }
+
+    void walk(const std::vector<Statement*>& statements) {
+        for (auto statement : statements) {
+            pending.push_back(statement);
+
+            while (!pending.empty()) {
+                Statement* node = pending.back();
+                pending.pop_back();
+
+                if constexpr (Static)
+                    this->apply(node);
+                else
+                    node->accept(*this);
+            }
+        }
+    }
+};
+
+void appendPhase(std::string& json, const char* name, const PhaseResult& phase, bool last = false) {
+    double megabytes = phase.bytes / (1024.0 * 1024.0);
+
+    appendFormat(json, "      \"%s\": { \"seconds\": %d, \"mb_per_s\": %d, \"tokens_per_s\": %d, \"nodes_per_s\": %d }%s\n",
+        name, phase.seconds, megabytes / phase.seconds, phase.tokens / phase.seconds, phase.nodes / phase.seconds, last ? "" : ",");
+}
+
+std::string benchShape(SourceShape shape, const BenchOptions& options) {
+    GeneratorOptions generatorOptions;
+    generatorOptions.shape = shape;
+    generatorOptions.bytes = static_cast<size_t>(options.megabytes * 1024 * 1024);
+    generatorOptions.seed = options.seed;
+    generatorOptions.depth = options.depth;
+
+    std::string source = SourceGenerator(generatorOptions).generate();
+
+    PhaseResult lex, parse, print, endToEnd;
+    std::vector<TokenInstance> tokens;
+
+    lex.seconds = fastest(options.iterations, [&]() {
+        Lexer lexer(source);
+        tokens = lexer.compile();
+    });
+    lex.bytes = source.size();
+    lex.tokens = tokens.size();
+
+    PhaseResult lexStore, parseStore;
+    TokenStore store;
+
+    lexStore.seconds = fastest(options.iterations, [&]() {
+        Lexer lexer(source);
+        store = lexer.compileStore();
+    });
+    lexStore.bytes = source.size();
+    lexStore.tokens = store.size();
+
+    // The source cut into chunks that are lexed on every hardware thread at once
+    PhaseResult lexParallel;
+    size_t lexThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    lexParallel.seconds = fastest(options.iterations, [&]() {
+        ParallelLexer lexer(source, nullptr, lexThreads);
+        benchSink = benchSink + lexer.compileStore().size();
+    });
+    lexParallel.bytes = source.size();
+    lexParallel.tokens = store.size();
+
+    // Every identifier and string interned on the way, into a private and into a shared table
+    PhaseResult lexInterned, lexShared;
+    SymbolTable symbolTable;
+    ConcurrentSymbolTable sharedSymbols;
+
+    lexInterned.seconds = fastest(options.iterations, [&]() {
+        Lexer lexer(source, &symbolTable);
+        benchSink = benchSink + lexer.compileStore().size();
+    });
+    lexInterned.bytes = source.size();
+    lexInterned.tokens = store.size();
+
+    lexShared.seconds = fastest(options.iterations, [&]() {
+        Lexer lexer(source, &sharedSymbols);
+        benchSink = benchSink + lexer.compileStore().size();
+    });
+    lexShared.bytes = source.size();
+    lexShared.tokens = store.size();
+
+    Arena arena;
+    std::vector<Statement*> statements;
+
+    parse.seconds = fastest(options.iterations, [&]() {
+        arena.release();
+        Parser parser(tokens, arena);
+        statements = parser.compile();
+    });
+    parse.bytes = source.size();
+    parse.tokens = tokens.size();
+    parse.nodes = arena.objectCount();
+
+    // The statement list grows geometrically and the arena blocks (counted too) cap at 4 MB, anything
+    // else here would be an allocation per token. test/AllocationTest.cpp enforces the bound.
+    arena.release();
+    size_t allocationsBefore = heapAllocations.load();
+    statements = Parser(tokens, arena).compile();
+    size_t parseAllocations = heapAllocations.load() - allocationsBefore;
+
+    parseStore.seconds = fastest(options.iterations, [&]() {
+        arena.release();
+        TokenStoreReader reader(store);
+        statements = Parser(reader, arena).compile();
+    });
+    parseStore.bytes = source.size();
+    parseStore.tokens = store.size();
+    parseStore.nodes = arena.objectCount();
+
+    // Lexing and parsing one after the other against the lexer running a step ahead on its own thread
+    PhaseResult serial, pipelined;
+    Arena pipelineArena;
+
+    auto lexParse = [&](PhaseResult& result, bool pipeline) {
+        result.seconds = fastest(options.iterations, [&]() {
+            pipelineArena.release();
+            ParseResult parsed = pipeline ? parseSourcePipelined(source, pipelineArena) : parseSource(source, pipelineArena);
+
+            result.tokens = parsed.tokens.size();
+        });
+        result.bytes = source.size();
+        result.nodes = pipelineArena.objectCount();
+    };
+
+    lexParse(serial, false);
+    lexParse(pipelined, true);
+
+    // An editor buffer in mid-edit: every 16th statement is followed by a broken one, which the
+    // parser reports and skips past
+    PhaseResult parseErrors;
+    Arena errorArena;
+    std::string broken;
+    size_t diagnosticCount = 0;
+
+    for (size_t i = 0, statementCount = 0; i < source.size(); i++) {
+        broken += source[i];
+
+        if (source[i] == ';' && ++statementCount % 16 == 0)
+            broken += " let ;";
+    }
+
+    parseErrors.seconds = fastest(options.iterations, [&]() {
+        errorArena.release();
+        ParseResult result = parseSource(broken, errorArena);
+
+        diagnosticCount = result.diagnostics.size();
+        parseErrors.tokens = result.tokens.size();
+    });
+    parseErrors.bytes = broken.size();
+    parseErrors.nodes = errorArena.objectCount();
+
+    double editSeconds = 0;
+
+    // Typing a statement in and deleting it again at random places
+    {
+        IncrementalDocument document(source);
+        uint64_t state = options.seed | 1;
+        const int edits = 1000;
+
+        editSeconds = fastest(options.iterations, [&]() {
+            for (int i = 0; i < edits; i++) {
+                state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+                size_t at = source.find(';', state % source.size());
+
+                if (at == std::string::npos)
+                    continue;
+
+                document.apply(TextEdit { at, 1, "; 0;" });
+                document.apply(TextEdit { at, 4, ";" });
+            }
+        }) / (2 * edits);
+    }
+
+    print.seconds = fastest(options.iterations, [&]() {
+        size_t written = 0;
+
+        for (auto statement : statements)
+            written += statement->toString().size();
+
+        print.bytes = written;
+    });
+    print.nodes = parse.nodes;
+
+    // The driver's dump: one printer appending every statement to one reused buffer
+    PhaseResult stream, streamCompact;
+    TreePrinter printer;
+    OutputBuffer output;
+
+    auto printAll = [&](PhaseResult& result, TreeFormat format) {
+        result.seconds = fastest(options.iterations, [&]() {
+            output.take();
+
+            for (auto statement : statements) {
+                printer.print(statement, output, format);
+                output.append('\n');
+            }
+
+            result.bytes = output.size();
+        });
+        result.nodes = parse.nodes;
+    };
+
+    printAll(stream, TreeFormat::SEXPR);
+    printAll(streamCompact, TreeFormat::COMPACT);
+
+    PhaseResult walkVirtual, walkStatic;
+    NodeSum<false> virtualSum;
+    NodeSum<true> staticSum;
+
+    walkVirtual.seconds = fastest(options.iterations, [&]() {
+        virtualSum.sum = 0;
+        virtualSum.walk(statements);
+    });
+    walkVirtual.nodes = parse.nodes;
+
+    walkStatic.seconds = fastest(options.iterations, [&]() {
+        staticSum.sum = 0;
+        staticSum.walk(statements);
+    });
+    walkStatic.nodes = parse.nodes;
+    benchSink = benchSink + (virtualSum.sum == staticSum.sum);
+
+    auto path = std::filesystem::temp_directory_path() / format("genesis_bench_%s_%i.gs", shapeName(shape), static_cast<long long>(::getpid()));
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+
+    if (file) {
+        std::fwrite(source.data(), 1, source.size(), file);
+        std::fclose(file);
+    }
+
+    endToEnd.seconds = fastest(options.iterations, [&]() {
+        SourceBuffer buffer;
+
+        if (!buffer.open(path.c_str()))
+            return;
+
+        Arena unitArena;
+        Lexer lexer(buffer.view());
+        Parser parser(lexer, unitArena);
+
+        benchSink = benchSink + parser.compile().size();
+    });
+    endToEnd.bytes = source.size();
+    endToEnd.tokens = tokens.size();
+    endToEnd.nodes = parse.nodes;
+
+    std::filesystem::remove(path);
+
+    std::string json;
+    appendFormat(json, "    {\n      \"shape\": \"%s\",\n      \"bytes\": %i,\n      \"tokens\": %i,\n      \"nodes\": %i,\n      \"arena_bytes\": %i,\n",
+        shapeName(shape), source.size(), tokens.size(), parse.nodes, arena.bytesUsed());
+    appendFormat(json, "      \"token_vector_bytes\": %i,\n      \"token_store_bytes\": %i,\n",
+        tokens.size() * sizeof(TokenInstance), store.bytes());
+    appendPhase(json, "lex", lex);
+    appendPhase(json, "parse", parse);
+    appendPhase(json, "lex_interned", lexInterned);
+    appendPhase(json, "lex_interned_shared", lexShared);
+    appendFormat(json, "      \"symbols\": %i,\n      \"symbol_table_bytes\": %i,\n", symbolTable.size(), symbolTable.bytes());
+    appendPhase(json, "lex_store", lexStore);
+    appendPhase(json, "lex_parallel", lexParallel);
+    appendFormat(json, "      \"lex_threads\": %i,\n", lexThreads);
+    appendPhase(json, "parse_store", parseStore);
+    appendPhase(json, "lex_parse_serial", serial);
+    appendPhase(json, "lex_parse_pipelined", pipelined);
+    appendFormat(json, "      \"pipeline_speedup\": %d,\n", serial.seconds / pipelined.seconds);
+    appendPhase(json, "parse_with_errors", parseErrors);
+    appendFormat(json, "      \"diagnostics\": %i,\n", diagnosticCount);
+    appendFormat(json, "      \"parse_heap_allocations\": %i,\n      \"parse_heap_allocations_per_token\": %d,\n",
+        parseAllocations, parseAllocations / std::max<double>(1, tokens.size()));
+    appendFormat(json, "      \"incremental_edit\": { \"seconds_per_edit\": %d, \"full_reparse_seconds\": %d },\n",
+        editSeconds, lex.seconds + parse.seconds);
+    appendPhase(json, "to_string", print);
+    appendPhase(json, "print_stream", stream);
+    appendPhase(json, "print_stream_compact", streamCompact);
+    appendPhase(json, "walk_virtual", walkVirtual);
+    appendPhase(json, "walk_static", walkStatic);
+    appendFormat(json, "      \"static_dispatch_speedup\": %d,\n", walkVirtual.seconds / walkStatic.seconds);
+    appendPhase(json, "end_to_end", endToEnd);
+    appendFormat(json, "      \"peak_rss_kb\": %i\n    }", peakResidentKilobytes());
+
+    return json;
+}
+
+// One statement `depth` levels deep: ((a)), a + a + a, a + (a + (a)) or -(-(a))
+std::string nestedSource(std::string_view kind, size_t depth) {
+    std::string source;
+
+    if (kind == "left_chain") {
+        source += "a";
+
+        for (size_t i = 0; i < depth; i++)
+            source += " + a";
+    }
+    else {
+        const char* open = kind == "parens" ? "(" : kind == "right_chain" ? "a + (" : "-(";
+
+        for (size_t i = 0; i < depth; i++)
+            source += open;
+
+        source += "a";
+        source.append(depth, ')');
+    }
+
+    source += ";";
+    return source;
+}
+
+std::string benchNesting(const char* kind, size_t depth, const BenchOptions& options) {
+    std::string source = nestedSource(kind, depth);
+    std::vector<TokenInstance> tokens = Lexer(source).compile();
+
+    Arena arena;
+    std::vector<Statement*> statements;
+    size_t nodes = 0, printed = 0;
+
+    double parseSeconds = fastest(options.iterations, [&]() {
+        arena.release();
+        statements = Parser(tokens, arena).compile();
+    });
+
+    TreeWalk walk;
+
+    double walkSeconds = fastest(options.iterations, [&]() {
+        nodes = 0;
+
+        for (auto& statement : statements)
+            walk.postOrder(statement, [&](Statement*&) { nodes++; });
+    });
+
+    double printSeconds = fastest(options.iterations, [&]() {
+        printed = statements[0]->toString().size();
+    });
+
+    double compileSeconds = fastest(options.iterations, [&]() {
+        benchSink = benchSink + Compiler().compile(statements).code.size();
+    });
+
+    // Rewrites the tree in place, so it only runs once
+    auto start = std::chrono::steady_clock::now();
+    Optimizer(arena).run(statements);
+    std::chrono::duration<double> optimizeSeconds = std::chrono::steady_clock::now() - start;
+
+    std::string json;
+    appendFormat(json, "    { \"kind\": \"%s\", \"depth\": %i, \"nodes\": %i, \"printed_bytes\": %i, ", kind, depth, nodes, printed);
+    appendFormat(json, "\"parse_seconds\": %d, \"walk_seconds\": %d, \"to_string_seconds\": %d, \"compile_seconds\": %d, \"optimize_seconds\": %d, ",
+        parseSeconds, walkSeconds, printSeconds, compileSeconds, optimizeSeconds.count());
+    appendFormat(json, "\"parse_ns_per_level\": %d, \"peak_rss_kb\": %i }", parseSeconds * 1e9 / depth, peakResidentKilobytes());
+
+    return json;
+}
+
+// An embedded snippet as a host application would keep it, lexed at compile time
+constexpr char snippetText[] =
+    "let width = 1_920; let height = 1_080; let ratio = width / height;\n"
+    "let scale = 0.75 * ratio + 1.5e-3; // fitted\n"
+    "let mask = 0xFF_FF; let label = \"viewport\"; let clamp = scale >= 1.0 != false;\n";
+
+constexpr auto snippetTokens = genesis::lex(snippetText);
+
+std::string benchSnippet(const BenchOptions& options) {
+    constexpr int rounds = 1000;
+    size_t lexed = 0, taken = 0;
+
+    double lexSeconds = fastest(options.iterations, [&]() {
+        for (int i = 0; i < rounds; i++)
+            lexed += Lexer(std::string_view(snippetText, sizeof(snippetText) - 1)).compile().size();
+    });
+
+    double staticSeconds = fastest(options.iterations, [&]() {
+        for (int i = 0; i < rounds; i++)
+            taken += snippetTokens.instances().size();
+    });
+
+    benchSink = benchSink + lexed + taken;
+
+    std::string json;
+    appendFormat(json, "  \"snippet\": { \"bytes\": %i, \"tokens\": %i, \"lex_ns\": %d, \"static_ns\": %d },\n",
+        sizeof(snippetText) - 1, snippetTokens.size(), lexSeconds * 1e9 / rounds, staticSeconds * 1e9 / rounds);
+
+    return json;
+}
+
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (!value)
+            return false;
+
+        if (argument == "--shape") {
+            SourceShape shape;
+
+            if (std::string_view(value) == "all")
+                options.shapes = { SourceShape::MIXED, SourceShape::DEEP, SourceShape::IDENTIFIERS, SourceShape::COMMENTS, SourceShape::STRINGS, SourceShape::KEYWORDS, SourceShape::NUMBERS };
+            else if (shapeFromName(value, shape))
+                options.shapes.push_back(shape);
+            else
+                return false;
+        }
+        else if (argument == "--size")
+            options.megabytes = std::atof(value);
+        else if (argument == "--iterations")
+            options.iterations = std::max(1, std::atoi(value));
+        else if (argument == "--seed")
+            options.seed = std::strtoull(value, nullptr, 0);
+        else if (argument == "--depth")
+            options.depth = std::max(1, std::atoi(value));
+        else if (argument == "--max-nesting")
+            options.maxNesting = std::strtoull(value, nullptr, 0);
+        else if (argument == "--output")
+            options.output = value;
+        else
+            return false;
+
+        i++;
+    }
+
+    if (options.shapes.empty())
+        options.shapes = { SourceShape::MIXED, SourceShape::DEEP, SourceShape::IDENTIFIERS, SourceShape::COMMENTS, SourceShape::STRINGS, SourceShape::KEYWORDS, SourceShape::NUMBERS };
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr
+            << ">> genesis_bench:\n"
+            << "Usage: genesis_bench [--shape name|all] [--size MB] [--iterations N] [--seed N] [--depth N] [--max-nesting N] [--output file]\n";
+
+        return 1;
+    }
+
+    std::string json = "{\n";
+    appendFormat(json, "  \"scan\": \"%s\",\n  \"size_mb\": %d,\n  \"iterations\": %i,\n  \"seed\": %i,\n  \"results\": [\n",
+        scanFunctions().name, options.megabytes, options.iterations, static_cast<unsigned long long>(options.seed));
+
+    for (size_t i = 0; i < options.shapes.size(); i++) {
+        json += benchShape(options.shapes[i], options);
+        json += (i + 1 < options.shapes.size()) ? ",\n" : "\n";
+    }
+
+    json += "  ],\n  \"nesting\": [\n";
+    bool first = true;
+
+    for (size_t depth = 100; options.maxNesting && depth <= options.maxNesting; depth *= 10) {
+        for (auto kind : { "parens", "left_chain", "right_chain", "unary" }) {
+            json += first ? "" : ",\n";
+            json += benchNesting(kind, depth, options);
+            first = false;
+        }
+    }
+
+    json += first ? "" : "\n";
+
+    json += "  ],\n";
+    json += benchSnippet(options);
+    appendFormat(json, "  \"peak_rss_kb\": %i\n}\n", peakResidentKilobytes());
+
+    if (options.output.empty()) {
+        std::cout << json;
+        return 0;
+    }
+
+    std::FILE* file = std::fopen(options.output.c_str(), "wb");
+
+    if (!file) {
+        std::cerr << ">> genesis_bench:\nCould not open '" << options.output << "' for writing...\n";
+        return 1;
+    }
+
+    std::fwrite(json.data(), 1, json.size(), file);
+    std::fclose(file);
+
+    return 0;
+}
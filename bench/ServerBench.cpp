@@ -0,0 +1,282 @@
+#include "../include/Driver/Server.hpp"
+#include "SourceGenerator.hpp"
+#include <chrono>
+#include <spawn.h>
+#include <sys/wait.h>
+
+// Per-request latency of the compile server against cold invocations of the Genesis executable.
+// The same requests, cycling over a few generated files, are run three ways:
+//   cold:   one Genesis process per request
+//   client: one genesis_client process per request against Genesis --serve-socket
+//   warm:   framed requests straight into a Genesis --serve process over a pipe
+// Every way shares the tree cache directory, so all of them see cache hits after the first round.
+
+extern char** environ;
+
+struct ServerBenchOptions {
+    std::string genesis, client;
+    size_t requests = 200;
+    size_t files = 8;
+    size_t kilobytes = 4;
+    SourceShape shape = SourceShape::MIXED;
+    std::string output;
+};
+
+struct Latencies {
+    std::vector<double> milliseconds;
+
+    double percentile(double rank) {
+        if (milliseconds.empty())
+            return 0;
+
+        std::vector<double> sorted = milliseconds;
+        std::sort(sorted.begin(), sorted.end());
+
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(rank * (sorted.size() - 1) + 0.5))];
+    }
+
+    double mean() {
+        double total = 0;
+
+        for (double value : milliseconds)
+            total += value;
+
+        return milliseconds.empty() ? 0 : total / milliseconds.size();
+    }
+};
+
+// Starts `arguments` with stdin and stdout on the given descriptors (-1 for /dev/null)
+pid_t spawn(const std::vector<std::string>& arguments, int input = -1, int output = -1) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+
+    if (input >= 0)
+        posix_spawn_file_actions_adddup2(&actions, input, STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    if (output >= 0)
+        posix_spawn_file_actions_adddup2(&actions, output, STDOUT_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::vector<char*> argv;
+
+    for (auto& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+
+    argv.push_back(nullptr);
+
+    pid_t child = -1;
+
+    if (posix_spawn(&child, argv[0], &actions, nullptr, argv.data(), environ) != 0)
+        child = -1;
+
+    posix_spawn_file_actions_destroy(&actions);
+    return child;
+}
+
+int waitFor(pid_t child) {
+    int status = 0;
+
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR) {}
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One process per request, `prefix` followed by the request's arguments
+bool runProcesses(const std::vector<std::string>& prefix, const std::vector<std::vector<std::string>>& requests, Latencies& latencies) {
+    for (auto& request : requests) {
+        std::vector<std::string> arguments = prefix;
+        arguments.insert(arguments.end(), request.begin(), request.end());
+
+        auto start = std::chrono::steady_clock::now();
+        pid_t child = spawn(arguments);
+
+        if (child < 0 || waitFor(child) != 0)
+            return false;
+
+        latencies.milliseconds.push_back(millisecondsSince(start));
+    }
+
+    return true;
+}
+
+bool runWarm(const std::string& genesis, const std::vector<std::vector<std::string>>& requests, Latencies& latencies) {
+    int toServer[2], fromServer[2];
+
+    if (::pipe(toServer) != 0 || ::pipe(fromServer) != 0)
+        return false;
+
+    // Otherwise the server inherits our end of its stdin and never sees it close
+    for (int descriptor : { toServer[0], toServer[1], fromServer[0], fromServer[1] })
+        ::fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+
+    pid_t child = spawn({ genesis, "--serve" }, toServer[0], fromServer[1]);
+    ::close(toServer[0]);
+    ::close(fromServer[1]);
+
+    std::error_code code;
+    std::string directory = std::filesystem::current_path(code).string();
+    std::string response;
+    bool success = child >= 0;
+
+    for (size_t i = 0; success && i < requests.size(); i++) {
+        std::string payload;
+        Protocol::appendField(payload, "compile");
+        Protocol::appendField(payload, directory);
+        Protocol::appendField(payload, "");
+
+        for (auto& argument : requests[i])
+            Protocol::appendField(payload, argument);
+
+        auto start = std::chrono::steady_clock::now();
+        success = Protocol::writeFrame(toServer[1], payload) && Protocol::readFrame(fromServer[0], response);
+
+        if (success) {
+            latencies.milliseconds.push_back(millisecondsSince(start));
+            success = Protocol::fields(response).at(0) == "0";
+        }
+    }
+
+    ::close(toServer[1]);
+    ::close(fromServer[0]);
+
+    return child >= 0 && waitFor(child) == 0 && success;
+}
+
+bool runClients(const ServerBenchOptions& options, const std::string& socket, const std::vector<std::vector<std::string>>& requests, Latencies& latencies) {
+    pid_t server = spawn({ options.genesis, "--serve-socket", socket });
+
+    if (server < 0)
+        return false;
+
+    // Waits for the server to listen before the first timed request
+    for (int i = 0; i < 500; i++) {
+        if (int probe = connectToServer(socket); probe >= 0) {
+            ::close(probe);
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    bool success = runProcesses({ options.client, "--socket", socket }, requests, latencies);
+    pid_t stop = spawn({ options.client, "--socket", socket, "--shutdown" });
+
+    return success && stop >= 0 && waitFor(stop) == 0 && waitFor(server) == 0;
+}
+
+std::string latencyJson(const char* name, Latencies& latencies) {
+    return format("    \"%s\": { \"requests\": %i, \"p50_ms\": %d, \"p99_ms\": %d, \"mean_ms\": %d }",
+        name, latencies.milliseconds.size(), latencies.percentile(0.5), latencies.percentile(0.99), latencies.mean());
+}
+
+bool parseArguments(int argc, char** argv, ServerBenchOptions& options) {
+    std::filesystem::path directory = std::filesystem::path(argv[0]).parent_path();
+    options.genesis = (directory / "Genesis").string();
+    options.client = (directory / "genesis_client").string();
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--genesis" && hasValue)
+            options.genesis = argv[++i];
+        else if (argument == "--client" && hasValue)
+            options.client = argv[++i];
+        else if (argument == "--requests" && hasValue)
+            options.requests = std::strtoul(argv[++i], nullptr, 10);
+        else if (argument == "--files" && hasValue)
+            options.files = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if (argument == "--size" && hasValue)
+            options.kilobytes = std::strtoul(argv[++i], nullptr, 10);
+        else if (argument == "--shape" && hasValue) {
+            if (!shapeFromName(argv[++i], options.shape))
+                return false;
+        }
+        else if (argument == "--output" && hasValue)
+            options.output = argv[++i];
+        else
+            return false;
+    }
+
+    return options.requests > 0;
+}
+
+int main(int argc, char** argv) {
+    ServerBenchOptions options;
+
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr
+            << ">> genesis_server_bench:\n"
+            << "Usage: genesis_server_bench [--genesis path] [--client path] [--requests N] [--files N] [--size KB] [--shape name] [--output file]\n";
+
+        return 1;
+    }
+
+    std::error_code code;
+    std::filesystem::path scratch = std::filesystem::temp_directory_path(code) / ("genesis-server-bench-" + std::to_string(::getpid()));
+    std::filesystem::create_directories(scratch, code);
+
+    std::vector<std::string> files;
+
+    for (size_t i = 0; i < options.files; i++) {
+        GeneratorOptions generator;
+        generator.shape = options.shape;
+        generator.bytes = options.kilobytes << 10;
+        generator.seed = 0x5eed + i;
+
+        files.push_back((scratch / ("input" + std::to_string(i) + ".gs")).string());
+        std::ofstream(files.back(), std::ios::binary) << SourceGenerator(generator).generate();
+    }
+
+    std::vector<std::vector<std::string>> requests;
+
+    for (size_t i = 0; i < options.requests; i++)
+        requests.push_back({ "--cache-dir", (scratch / "cache").string(), files[i % files.size()] });
+
+    Latencies cold, client, warm;
+    bool success = runProcesses({ options.genesis }, requests, cold)
+        && runClients(options, (scratch / "server.sock").string(), requests, client)
+        && runWarm(options.genesis, requests, warm);
+
+    std::filesystem::remove_all(scratch, code);
+
+    if (!success) {
+        std::cerr << ">> genesis_server_bench:\nA request failed, is '" << options.genesis << "' (and '" << options.client << "') the Genesis build to measure?\n";
+        return 1;
+    }
+
+    std::string json = "{\n";
+    appendFormat(json, "  \"shape\": \"%s\",\n  \"size_kb\": %i,\n  \"files\": %i,\n  \"latency\": {\n",
+        shapeName(options.shape), options.kilobytes, options.files);
+    json += latencyJson("cold", cold) + ",\n";
+    json += latencyJson("client", client) + ",\n";
+    json += latencyJson("warm", warm) + "\n";
+    appendFormat(json, "  },\n  \"p50_speedup_client\": %d,\n  \"p50_speedup_warm\": %d\n}\n",
+        cold.percentile(0.5) / std::max(client.percentile(0.5), 1e-9), cold.percentile(0.5) / std::max(warm.percentile(0.5), 1e-9));
+
+    if (options.output.empty()) {
+        std::cout << json;
+        return 0;
+    }
+
+    std::FILE* file = std::fopen(options.output.c_str(), "wb");
+
+    if (!file) {
+        std::cerr << ">> genesis_server_bench:\nCould not open '" << options.output << "' for writing...\n";
+        return 1;
+    }
+
+    std::fwrite(json.data(), 1, json.size(), file);
+    std::fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef SOURCE_GENERATOR_GENESIS
+#define SOURCE_GENERATOR_GENESIS
+
+#include "../include/AST/Keywords.hpp"
+#include <cstdint>
+
+// Deterministic generator of Genesis source for the benchmarks. The same options always produce
+// the same bytes on every platform (own PRNG, no <random> distributions), and every statement it
+// writes is accepted by the Parser.
+enum class SourceShape {
+    MIXED,
+    DEEP,           // nested groupings
+    IDENTIFIERS,    // long identifiers
+    COMMENTS,       // mostly comment lines and indentation
+    STRINGS,        // long string literals
+    KEYWORDS,       // let / true / false / null
+    NUMBERS,        // number literals of every form, like a data script
+};
+
+inline const char* shapeName(SourceShape shape) {
+    switch (shape) {
+        case SourceShape::MIXED: return "mixed";
+        case SourceShape::DEEP: return "deep";
+        case SourceShape::IDENTIFIERS: return "identifiers";
+        case SourceShape::COMMENTS: return "comments";
+        case SourceShape::STRINGS: return "strings";
+        case SourceShape::KEYWORDS: return "keywords";
+        case SourceShape::NUMBERS: return "numbers";
+    }
+
+    return "unknown";
+}
+
+inline bool shapeFromName(std::string_view name, SourceShape& shape) {
+    for (auto candidate : { SourceShape::MIXED, SourceShape::DEEP, SourceShape::IDENTIFIERS, SourceShape::COMMENTS, SourceShape::STRINGS, SourceShape::KEYWORDS, SourceShape::NUMBERS }) {
+        if (name == shapeName(candidate)) {
+            shape = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct GeneratorOptions {
+    SourceShape shape = SourceShape::MIXED;
+    size_t bytes = 1 << 20;          // stops at the first statement boundary past this size
+    uint64_t seed = 0x5eed;
+    int depth = 64;                  // nesting of DEEP statements
+    int identifierLength = 32;       // average length of IDENTIFIERS names
+};
+
+class SourceGenerator {
+private:
+    GeneratorOptions options;
+    uint64_t state;
+    std::string output;
+
+    // xorshift64*
+    uint64_t random() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    int below(int limit) {
+        return static_cast<int>(random() % static_cast<uint64_t>(limit));
+    }
+
+    void indent() {
+        output.append(4 * (1 + below(4)), ' ');
+    }
+
+    void word(int length) {
+        static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+        static const char tail[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+
+        size_t start = output.size();
+        output += letters[below(sizeof(letters) - 1)];
+
+        for (int i = 1; i < length; i++)
+            output += tail[below(sizeof(tail) - 1)];
+
+        // Random words may spell a keyword, which would not parse as an operand
+        if (keywordClass(std::string_view(output).substr(start)) != TokenClass::T_IDENTIFIER)
+            output += '_';
+    }
+
+    void identifier() {
+        word(std::max(1, options.identifierLength / 2 + below(options.identifierLength + 1)));
+    }
+
+    void operand() {
+        switch (below(4)) {
+            case 0: output += std::to_string(below(100000)); break;
+            case 1: output += std::to_string(below(1000)) + "." + std::to_string(below(100)); break;
+            default: word(3 + below(8)); break;
+        }
+    }
+
+    const char* binaryOperator() {
+        static const char* operators[] = { " + ", " - ", " * ", " / ", " == ", " != ", " < ", " <= ", " > ", " >= " };
+        return operators[below(10)];
+    }
+
+    void expression(int terms) {
+        operand();
+
+        for (int i = 1; i < terms; i++) {
+            output += binaryOperator();
+            operand();
+        }
+    }
+
+    void deepStatement() {
+        indent();
+        output.append(options.depth, '(');
+        operand();
+
+        for (int i = 0; i < options.depth; i++) {
+            output += binaryOperator();
+            operand();
+            output += ')';
+        }
+
+        output += ";\n";
+    }
+
+    void identifierStatement() {
+        indent();
+        output += "let ";
+        identifier();
+        output += " = ";
+        identifier();
+
+        for (int i = below(3); i >= 0; i--) {
+            output += binaryOperator();
+            identifier();
+        }
+
+        output += ";\n";
+    }
+
+    void commentStatement() {
+        static const char* words[] = { "the", "value", "below", "is", "generated", "from", "schema", "field", "and", "must", "not", "change" };
+
+        for (int lines = 1 + below(4); lines > 0; lines--) {
+            indent();
+            output += "//";
+
+            for (int i = 4 + below(12); i > 0; i--) {
+                output += ' ';
+                output += words[below(12)];
+            }
+
+            output += '\n';
+        }
+
+        indent();
+        expression(2 + below(3));
+        output += ";\n";
+    }
+
+    void stringStatement() {
+        static const char* words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do" };
+
+        indent();
+        output += "let ";
+        word(4 + below(6));
+        output += " = ";
+
+        for (int parts = 1 + below(3); parts > 0; parts--) {
+            output += '"';
+
+            for (int i = 4 + below(24); i > 0; i--) {
+                output += words[below(10)];
+                output += ' ';
+            }
+
+            output += '"';
+
+            if (parts > 1)
+                output += " + ";
+        }
+
+        output += ";\n";
+    }
+
+    void keywordStatement() {
+        static const char* keywords[] = { "true", "false", "null" };
+
+        indent();
+
+        if (below(2)) {
+            output += "let ";
+            word(2 + below(4));
+            output += " = ";
+        }
+
+        output += keywords[below(3)];
+
+        for (int i = below(4); i > 0; i--) {
+            output += below(2) ? " == " : " != ";
+            output += keywords[below(3)];
+        }
+
+        output += ";\n";
+    }
+
+    void number() {
+        switch (below(5)) {
+            case 0: output += std::to_string(random() % 1000000000000ull); break;
+            case 1: output += std::to_string(below(1000)) + "_" + std::to_string(100 + below(900)) + "_" + std::to_string(100 + below(900)); break;
+            case 2: output += std::to_string(below(100000)) + "." + std::to_string(random() % 1000000000ull); break;
+            case 3: output += std::to_string(below(10)) + "." + std::to_string(below(100000)) + "e" + (below(2) ? "-" : "+") + std::to_string(below(300)); break;
+            default:
+            {
+                char digits[16];
+                output += "0x";
+                output.append(digits, std::to_chars(digits, digits + sizeof(digits), static_cast<uint32_t>(random()), 16).ptr);
+            }
+            break;
+        }
+    }
+
+    void numberStatement() {
+        indent();
+        output += "let ";
+        word(2 + below(6));
+        output += " = ";
+        number();
+
+        for (int i = 2 + below(6); i > 0; i--) {
+            output += below(2) ? " + " : " * ";
+            number();
+        }
+
+        output += ";\n";
+    }
+
+    void statement(SourceShape shape) {
+        switch (shape) {
+            case SourceShape::MIXED: statement(static_cast<SourceShape>(1 + below(5))); break;
+            case SourceShape::DEEP: deepStatement(); break;
+            case SourceShape::IDENTIFIERS: identifierStatement(); break;
+            case SourceShape::COMMENTS: commentStatement(); break;
+            case SourceShape::STRINGS: stringStatement(); break;
+            case SourceShape::KEYWORDS: keywordStatement(); break;
+            case SourceShape::NUMBERS: numberStatement(); break;
+        }
+    }
+
+public:
+    SourceGenerator(GeneratorOptions _options) : options(_options), state(_options.seed ? _options.seed : 1) {}
+
+    std::string generate() {
+        output.clear();
+        output.reserve(options.bytes + 4096);
+
+        while (output.size() < options.bytes)
+            statement(options.shape);
+
+        return std::move(output);
+    }
+};
+
+#endif // SOURCE_GENERATOR_GENESIS
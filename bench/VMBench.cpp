@@ -0,0 +1,127 @@
+#include "../include/AST/Parser.hpp"
+#include "../include/VM/Compiler.hpp"
+#include "../include/VM/VM.hpp"
+#include <chrono>
+
+// Microbenchmark of expression evaluation: the same compilation unit evaluated on the bytecode VM
+// and by a straightforward tree-walking evaluator over the Visit interface, for comparison.
+
+class TreeWalker : public Visit {
+public:
+    std::unordered_map<std::string_view, double> globals;
+    double result = 0;
+
+    void visit(Expression&) {}
+
+    void visit(LiteralValue& node) {
+        if (node.token.token == TokenClass::T_IDENTIFIER) {
+            result = globals.at(node.token.value);
+            return;
+        }
+
+        std::from_chars(node.token.value.data(), node.token.value.data() + node.token.value.size(), result);
+    }
+
+    void visit(Binary& node) {
+        node.left->accept(*this);
+        double left = result;
+        node.right->accept(*this);
+
+        switch (node.op.token) {
+            case TokenClass::T_PLUS: result = left + result; break;
+            case TokenClass::T_MINUS: result = left - result; break;
+            case TokenClass::T_STAR: result = left * result; break;
+            case TokenClass::T_SLASH: result = left / result; break;
+            default: break;
+        }
+    }
+
+    void visit(Unary& node) {
+        node.right->accept(*this);
+        result = -result;
+    }
+
+    void visit(Grouping& node) {
+        node.expression->accept(*this);
+    }
+
+    void visit(Let& node) {
+        node.initializer->accept(*this);
+        globals[node.name.value] = result;
+    }
+};
+
+// Deterministic arithmetic expression with `terms` operands over two globals
+std::string buildSource(int terms) {
+    const char* operators[] = { " + ", " - ", " * ", " / " };
+    std::string source = "let a = 3;\nlet b = 1.25;\n";
+
+    for (int i = 0; i < terms; i++) {
+        if (i > 0)
+            source += operators[i % 4];
+
+        switch (i % 5) {
+            case 0: source += "(a + b)"; break;
+            case 1: source += "a"; break;
+            case 2: source += std::to_string(i % 7 + 1); break;
+            case 3: source += "(b * 2 - a)"; break;
+            case 4: source += "b"; break;
+        }
+    }
+
+    return source;
+}
+
+template <typename Function>
+double nanosecondsPerCall(int iterations, Function function) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++)
+        function();
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int terms = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    std::string source = buildSource(terms);
+    Lexer lexer(source);
+    std::vector<TokenInstance> tokens = lexer.compile();
+
+    Arena arena;
+    Parser parser(tokens, arena);
+    std::vector<Statement*> statements = parser.compile();
+
+    Chunk chunk = Compiler().compile(statements);
+    size_t instructions = 0;
+
+    for (size_t offset = 0; offset < chunk.code.size(); offset += 1 + opCodeOperandSize(chunk.code[offset]))
+        instructions++;
+
+    VM vm;
+    TreeWalker walker;
+    double vmResult = 0, walkerResult = 0;
+
+    double vmTime = nanosecondsPerCall(iterations, [&]() { vmResult = vm.run(chunk).number; });
+    double walkerTime = nanosecondsPerCall(iterations, [&]() {
+        for (auto statement : statements)
+            statement->accept(walker);
+
+        walkerResult = walker.result;
+    });
+
+    std::cout
+        << "terms:            " << terms << "\n"
+        << "instructions:     " << instructions << "\n"
+        << "vm ns/run:        " << vmTime << "\n"
+        << "vm ns/instr:      " << vmTime / instructions << "\n"
+        << "vm Minstr/s:      " << instructions / vmTime * 1000.0 << "\n"
+        << "tree ns/run:      " << walkerTime << "\n"
+        << "speedup:          " << walkerTime / vmTime << "x\n"
+        << "results agree:    " << (vmResult == walkerResult ? "yes" : "no") << "\n";
+
+    return vmResult == walkerResult ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#ifndef CHAR_CLASS_GENESIS
+#define CHAR_CLASS_GENESIS
+
+#include <array>
+#include <cstdint>
+
+// Character classes of the lexer, one table lookup instead of a chain of range comparisons
+enum CharClass : uint8_t {
+    CC_NONE = 0,
+    CC_DIGIT = 1 << 0,      // 0-9
+    CC_ALPHA = 1 << 1,      // a-z A-Z _
+    CC_SPACE = 1 << 2,      // whitespace that is skipped without side effects
+    CC_NEWLINE = 1 << 3,    // \n
+    CC_IDENTIFIER = CC_DIGIT | CC_ALPHA,
+};
+
+constexpr std::array<uint8_t, 256> buildCharClasses() {
+    std::array<uint8_t, 256> table {};
+
+    for (int i = '0'; i <= '9'; i++)
+        table[i] |= CC_DIGIT;
+
+    for (int i = 'a'; i <= 'z'; i++)
+        table[i] |= CC_ALPHA;
+
+    for (int i = 'A'; i <= 'Z'; i++)
+        table[i] |= CC_ALPHA;
+
+    table['_'] |= CC_ALPHA;
+
+    table[' '] |= CC_SPACE;
+    table['\t'] |= CC_SPACE;
+    table['\r'] |= CC_SPACE;
+    table['\b'] |= CC_SPACE;
+    table['\0'] |= CC_SPACE;
+
+    // Lines are counted on demand from the source (LineIndex), so newlines are plain whitespace too
+    table['\n'] |= CC_SPACE | CC_NEWLINE;
+
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> charClasses = buildCharClasses();
+
+constexpr bool hasCharClass(char input, uint8_t charClass) {
+    return (charClasses[static_cast<uint8_t>(input)] & charClass) != 0;
+}
+
+#endif // CHAR_CLASS_GENESIS
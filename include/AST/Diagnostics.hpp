@@ -0,0 +1,103 @@
+#ifndef DIAGNOSTICS_GENESIS
+#define DIAGNOSTICS_GENESIS
+
+#include "./LineIndex.hpp"
+
+// One problem found in a source. `at` views the lexeme (or character) it was found at inside the
+// source, a view without data means the end of the input. Lines and columns are only worked out
+// when the diagnostics are rendered.
+struct Diagnostic {
+    enum Phase { LEXER, PARSER } phase;
+    std::string message;
+    std::string_view at;
+};
+
+// Problems collected while lexing and parsing, instead of aborting at the first one. Recording
+// stops after `limit` entries so a binary file fed in by mistake cannot produce millions of them.
+class Diagnostics {
+private:
+    std::vector<Diagnostic> entries;
+    size_t dropped = 0;
+
+public:
+    static constexpr size_t limit = 256;
+
+    void report(Diagnostic::Phase phase, std::string message, std::string_view at) {
+        if (entries.size() >= limit) {
+            dropped++;
+            return;
+        }
+
+        entries.push_back(Diagnostic { phase, std::move(message), at });
+    }
+
+    void append(const Diagnostics& other) {
+        for (auto& entry : other.entries)
+            report(entry.phase, entry.message, entry.at);
+
+        dropped += other.dropped;
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    size_t size() const {
+        return entries.size() + dropped;
+    }
+
+    const Diagnostic& operator[](size_t index) const {
+        return entries[index];
+    }
+
+    std::vector<Diagnostic>::const_iterator begin() const {
+        return entries.begin();
+    }
+
+    std::vector<Diagnostic>::const_iterator end() const {
+        return entries.end();
+    }
+
+    void clear() {
+        entries.clear();
+        dropped = 0;
+    }
+
+    // Where `diagnostic` points in `source`, the source its views were taken from
+    static SourceLocation locate(const Diagnostic& diagnostic, LineIndex& lines, std::string_view source) {
+        if (!diagnostic.at.data())
+            return lines.locate(source.size());
+
+        return lines.locate(diagnostic.at);
+    }
+
+    // Every diagnostic in source order, with line and column
+    std::string render(std::string_view source) const {
+        LineIndex lines(source);
+        std::vector<const Diagnostic*> sorted;
+        std::string text;
+
+        for (auto& entry : entries)
+            sorted.push_back(&entry);
+
+        auto offset = [&](const Diagnostic* diagnostic) {
+            return diagnostic->at.data() ? static_cast<size_t>(diagnostic->at.data() - source.data()) : source.size();
+        };
+
+        std::stable_sort(sorted.begin(), sorted.end(), [&](const Diagnostic* a, const Diagnostic* b) { return offset(a) < offset(b); });
+
+        for (auto diagnostic : sorted) {
+            SourceLocation location = locate(*diagnostic, lines, source);
+
+            appendFormat(text, ">> GenesisException:\n>> Message: %s\n>> Line: %i\n>> Column: %i\n",
+                diagnostic->message, location.line, location.column);
+        }
+
+        if (dropped)
+            appendFormat(text, ">> GenesisException:\n>> Message: %i more problems were not reported...\n", dropped);
+
+        return text;
+    }
+};
+
+#endif // DIAGNOSTICS_GENESIS
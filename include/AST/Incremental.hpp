@@ -0,0 +1,501 @@
+#ifndef INCREMENTAL_GENESIS
+#define INCREMENTAL_GENESIS
+
+#include "./Lexer.hpp"
+#include "./Parser.hpp"
+#include <memory>
+
+// Replaces `length` bytes at `offset` with `replacement`, an insertion has length 0
+struct TextEdit {
+    size_t offset = 0;
+    size_t length = 0;
+    std::string_view replacement;
+};
+
+// What one edit cost, everything outside the damaged region is reused as is
+struct EditReport {
+    size_t bytesLexed = 0;
+    size_t tokensLexed = 0;
+    size_t statementsParsed = 0;
+    size_t statementsReused = 0;
+};
+
+// A source text kept parsed across edits, for editor integrations that re-compile on every keystroke.
+//
+// The text is split into segments, one per top-level statement, running from the statement's first
+// token up to the next statement's first token (the first segment also owns any leading trivia).
+// An edit re-lexes and re-parses only the segments it touches plus the one before it. The damaged
+// region grows one segment at a time until the fresh token stream lines up with the old one again,
+// i.e. a token starts exactly where the next untouched segment starts, and the parser finished its
+// last statement without reading past the region. Lexing and parsing are both deterministic from a
+// statement boundary, so every segment after that point is still exactly what a full parse gives.
+//
+// Segments produced together share a Batch with the text, and the arena for their nodes, so
+// statements reused from earlier parses stay valid for as long as the document holds them.
+class IncrementalDocument {
+private:
+    struct Batch {
+        std::string text;
+        Arena arena { 4 * 1024 };
+    };
+
+    struct Segment {
+        std::shared_ptr<Batch> batch;
+        std::string_view text;
+        Statement* statement = nullptr;
+        bool broken = false;   // failed to lex or parse, re-done by every later edit
+    };
+
+    // Segments in text order, kept as an implicit treap: every node knows how many segments and
+    // how many bytes its subtree holds, so finding the segment at an offset, reaching the i-th one
+    // and splicing a run of them all take O(log n) plus the segments added or removed
+    class SegmentSequence {
+    private:
+        struct Node {
+            Segment segment;
+            uint32_t priority = 0;
+            int left = -1, right = -1;
+            size_t count = 1;
+            size_t length = 0;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<int> unused;
+        int root = -1;
+        uint32_t state = 0x9E3779B9;
+
+        size_t count(int node) const {
+            return node < 0 ? 0 : nodes[node].count;
+        }
+
+        size_t length(int node) const {
+            return node < 0 ? 0 : nodes[node].length;
+        }
+
+        void update(int node) {
+            Node& current = nodes[node];
+            current.count = 1 + count(current.left) + count(current.right);
+            current.length = current.segment.text.size() + length(current.left) + length(current.right);
+        }
+
+        // xorshift32, the priorities only have to look random to keep the tree balanced
+        uint32_t nextPriority() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            return state;
+        }
+
+        int make(const Segment& segment) {
+            int node;
+
+            if (unused.empty()) {
+                node = static_cast<int>(nodes.size());
+                nodes.emplace_back();
+            }
+            else {
+                node = unused.back();
+                unused.pop_back();
+            }
+
+            nodes[node] = Node { segment, nextPriority(), -1, -1, 1, segment.text.size() };
+            return node;
+        }
+
+        int merge(int left, int right) {
+            if (left < 0 || right < 0)
+                return left < 0 ? right : left;
+
+            if (nodes[left].priority > nodes[right].priority) {
+                nodes[left].right = merge(nodes[left].right, right);
+                update(left);
+
+                return left;
+            }
+
+            nodes[right].left = merge(left, nodes[right].left);
+            update(right);
+
+            return right;
+        }
+
+        // The first `k` segments of `node` go to `left`, the rest to `right`
+        void split(int node, size_t k, int& left, int& right) {
+            if (node < 0) {
+                left = right = -1;
+                return;
+            }
+
+            if (count(nodes[node].left) < k) {
+                split(nodes[node].right, k - count(nodes[node].left) - 1, nodes[node].right, right);
+                left = node;
+            }
+            else {
+                split(nodes[node].left, k, left, nodes[node].left);
+                right = node;
+            }
+
+            update(node);
+        }
+
+        // Hands every segment of the subtree to `removed` and frees its nodes
+        template <typename Function>
+        void release(int node, Function& removed) {
+            if (node < 0)
+                return;
+
+            release(nodes[node].left, removed);
+            removed(nodes[node].segment);
+            release(nodes[node].right, removed);
+
+            nodes[node].segment = Segment();
+            unused.push_back(node);
+        }
+
+    public:
+        size_t size() const {
+            return count(root);
+        }
+
+        bool empty() const {
+            return root < 0;
+        }
+
+        const Segment& operator[](size_t index) const {
+            int node = root;
+
+            while (true) {
+                size_t before = count(nodes[node].left);
+
+                if (index < before)
+                    node = nodes[node].left;
+                else if (index == before)
+                    return nodes[node].segment;
+                else {
+                    index -= before + 1;
+                    node = nodes[node].right;
+                }
+            }
+        }
+
+        // Index of the segment holding `position`, the end of the text belongs to the last segment
+        size_t locate(size_t position, size_t& segmentStart) const {
+            segmentStart = 0;
+
+            if (position >= length(root)) {
+                const Segment& last = (*this)[size() - 1];
+                segmentStart = length(root) - last.text.size();
+
+                return size() - 1;
+            }
+
+            int node = root;
+            size_t index = 0;
+
+            while (true) {
+                const Node& current = nodes[node];
+                size_t leftLength = length(current.left);
+
+                if (position < segmentStart + leftLength)
+                    node = current.left;
+                else if (position < segmentStart + leftLength + current.segment.text.size()) {
+                    segmentStart += leftLength;
+                    return index + count(current.left);
+                }
+                else {
+                    segmentStart += leftLength + current.segment.text.size();
+                    index += count(current.left) + 1;
+                    node = current.right;
+                }
+            }
+        }
+
+        // Replaces segments [first, last] (none when the sequence is empty) with `replacement`,
+        // each segment taken out is handed to `removed` first
+        template <typename Function>
+        void replace(size_t first, size_t last, const std::vector<Segment>& replacement, Function removed) {
+            size_t removing = empty() ? 0 : last - first + 1;
+            int before, middle, after;
+
+            split(root, first, before, middle);
+            split(middle, removing, middle, after);
+            release(middle, removed);
+
+            for (auto& segment : replacement)
+                before = merge(before, make(segment));
+
+            root = merge(before, after);
+        }
+
+        template <typename Function>
+        void forEach(Function function) const {
+            std::vector<int> stack;
+            int node = root;
+
+            while (node >= 0 || !stack.empty()) {
+                while (node >= 0) {
+                    stack.push_back(node);
+                    node = nodes[node].left;
+                }
+
+                node = stack.back();
+                stack.pop_back();
+
+                function(nodes[node].segment);
+                node = nodes[node].right;
+            }
+        }
+    };
+
+    SegmentSequence segments;
+    std::string diagnostic;
+    size_t length = 0;
+    size_t brokenSegments = 0;
+    size_t statementSegments = 0;
+
+    // Swaps segments [first, last] for `replacement`, keeping the broken and statement counts
+    void splice(size_t first, size_t last, const std::vector<Segment>& replacement) {
+        segments.replace(first, last, replacement, [this](const Segment& segment) {
+            brokenSegments -= segment.broken;
+            statementSegments -= segment.statement != nullptr;
+        });
+
+        for (auto& segment : replacement) {
+            brokenSegments += segment.broken;
+            statementSegments += segment.statement != nullptr;
+        }
+    }
+
+    // "<message> (line <n> of the edited region)"
+    static std::string describe(const Diagnostic& diagnostic, std::string_view region) {
+        LineIndex lines(region);
+        return format("%s (line %i of the edited region)", diagnostic.message, Diagnostics::locate(diagnostic, lines, region).line);
+    }
+
+    // Lexes `batch` up to the first token starting at or after `boundary`. False if no token starts
+    // exactly there, in which case the old and new token streams have not lined up yet. Any lexer
+    // problem on the way ends up in `problem`.
+    bool lexRegion(Batch& batch, size_t boundary, std::vector<TokenInstance>& tokens, EditReport& report, std::string& problem) {
+        Lexer lexer(batch.text);
+        bool synced = false;
+        TokenInstance token;
+        const char* limit = batch.text.data() + boundary;
+
+        tokens.clear();
+
+        while (true) {
+            if (!lexer.fill(&token, 1)) {
+                report.bytesLexed += batch.text.size();
+                synced = boundary == batch.text.size();
+                break;
+            }
+
+            report.tokensLexed++;
+
+            if (token.value.data() >= limit) {
+                report.bytesLexed += token.value.data() - batch.text.data();
+
+                // Strings are stored without their opening quote
+                const char* start = token.value.data() - (token.token == TokenClass::T_STRING ? 1 : 0);
+                synced = start == limit;
+                break;
+            }
+
+            tokens.push_back(token);
+        }
+
+        if (!lexer.diagnostics().empty())
+            problem = describe(lexer.diagnostics()[0], batch.text);
+
+        return synced;
+    }
+
+    void fail(size_t first, size_t last, std::string text, std::string message) {
+        auto batch = std::make_shared<Batch>();
+        batch->text = std::move(text);
+
+        splice(first, last, { Segment { batch, batch->text, nullptr, true } });
+        diagnostic = std::move(message);
+    }
+
+    // Re-lexes and re-parses `text`, which replaces segments [first, last], growing the region
+    // over the following segments until it re-syncs with them
+    EditReport reparse(size_t first, size_t last, std::string text) {
+        EditReport report;
+        std::vector<TokenInstance> tokens;
+
+        while (true) {
+            bool hasNext = last + 1 < segments.size();
+
+            // A broken tail is re-done until it parses again
+            if (hasNext && segments[last + 1].broken) {
+                text += segments[++last].text;
+                continue;
+            }
+
+            auto batch = std::make_shared<Batch>();
+            batch->text = text;
+
+            // The next segment comes along so tokens can be compared across the boundary
+            if (hasNext)
+                batch->text += segments[last + 1].text;
+
+            std::string problem;
+            bool synced = lexRegion(*batch, text.size(), tokens, report, problem);
+
+            if (!problem.empty()) {
+                if (hasNext) {
+                    text += segments[++last].text;
+                    continue;
+                }
+
+                fail(first, last, std::move(text), std::move(problem));
+                return report;
+            }
+
+            if (!synced) {
+                text += segments[++last].text;
+                continue;
+            }
+
+            std::vector<Segment> parsed;
+            const char* regionStart = batch->text.data();
+            Parser parser(tokens, batch->arena);
+            bool complete = true;
+
+            while (!parser.atEnd()) {
+                const TokenInstance& firstToken = parser.at();
+                const char* start = firstToken.value.data() - (firstToken.token == TokenClass::T_STRING ? 1 : 0);
+
+                if (parsed.empty())
+                    start = regionStart;
+                else
+                    parsed.back().text = std::string_view(parsed.back().text.data(), start - parsed.back().text.data());
+
+                Statement* statement = parser.statement();
+
+                if (!statement)
+                    break;
+
+                // Without its ';' in the region the statement may still find one in the next segment
+                if (parser.atEnd())
+                    parser.advanceCurrent();
+                else if (!parser.endStatement())
+                    break;
+
+                parsed.push_back(Segment { batch, std::string_view(start, 0), statement, false });
+                report.statementsParsed++;
+            }
+
+            complete = !parser.overran();
+
+            if (!parser.diagnostics().empty()) {
+                const Diagnostic& error = parser.diagnostics()[0];
+
+                // Running out of tokens is only an error once there is nothing left to take in
+                if (!hasNext || error.at.data()) {
+                    fail(first, last, std::move(text), describe(error, batch->text));
+                    return report;
+                }
+
+                complete = false;
+            }
+
+            // The last statement wanted tokens from the next segment
+            if (!complete && hasNext) {
+                text += segments[++last].text;
+                continue;
+            }
+
+            if (parsed.empty())
+                parsed.push_back(Segment { batch, std::string_view(regionStart, 0), nullptr, false });
+
+            parsed.back().text = std::string_view(parsed.back().text.data(), regionStart + text.size() - parsed.back().text.data());
+
+            // A region reduced to nothing simply disappears, unless it was the whole document
+            if (text.empty() && segments.size() > last - first + 1)
+                parsed.clear();
+
+            splice(first, last, parsed);
+
+            // An error elsewhere stays until an edit reaches it
+            if (brokenSegments == 0)
+                diagnostic.clear();
+
+            // Every statement outside the new batch was reused
+            report.statementsReused = statementSegments - std::count_if(parsed.begin(), parsed.end(), [](const Segment& segment) { return segment.statement; });
+
+            return report;
+        }
+    }
+
+public:
+    IncrementalDocument(std::string text) : length(text.size()) {
+        reparse(0, 0, std::move(text));
+    }
+
+    EditReport apply(const TextEdit& edit) {
+        size_t total = size();
+        size_t offset = std::min(edit.offset, total);
+        size_t end = std::min(total, offset + std::min(edit.length, total - offset));
+
+        size_t start, lastStart;
+        size_t first = segments.locate(offset, start);
+        size_t last = segments.locate(end, lastStart);
+
+        // One statement of left context, the edit may join its last token with the new text
+        if (first > 0) {
+            first--;
+            start -= segments[first].text.size();
+        }
+
+        std::string text;
+
+        for (size_t i = first; i <= last; i++)
+            text += segments[i].text;
+
+        text.replace(offset - start, end - offset, edit.replacement);
+        length += edit.replacement.size() - (end - offset);
+
+        return reparse(first, last, std::move(text));
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // The current text, rebuilt from the segments
+    std::string text() const {
+        std::string result;
+        result.reserve(size());
+
+        segments.forEach([&](const Segment& segment) { result += segment.text; });
+
+        return result;
+    }
+
+    // Top-level statements in source order, valid until the next edit replaces them
+    std::vector<Statement*> statements() const {
+        std::vector<Statement*> result;
+        result.reserve(statementSegments);
+
+        segments.forEach([&](const Segment& segment) {
+            if (segment.statement)
+                result.push_back(segment.statement);
+        });
+
+        return result;
+    }
+
+    bool ok() const {
+        return diagnostic.empty();
+    }
+
+    // Why the last edit left the document unparsable, empty when it parses
+    const std::string& error() const {
+        return diagnostic;
+    }
+};
+
+#endif // INCREMENTAL_GENESIS
@@ -0,0 +1,96 @@
+#ifndef KEYWORDS_GENESIS
+#define KEYWORDS_GENESIS
+
+#include "./TokenClass.hpp"
+#include <array>
+#include <cstdint>
+
+struct Keyword {
+    std::string_view text;
+    TokenClass token;
+};
+
+// Adding a keyword only needs a new line here, the hash table below is regenerated at compile time
+inline constexpr Keyword keywords[] = {
+    { "let", TokenClass::T_LET },
+    { "function", TokenClass::T_FUNCTION },
+    { "if", TokenClass::T_IF },
+    { "else", TokenClass::T_ELSE },
+    { "elseif", TokenClass::T_ELSEIF },
+    { "class", TokenClass::T_CLASS },
+    { "switch", TokenClass::T_SWITCH },
+    { "case", TokenClass::T_CASE },
+    { "default", TokenClass::T_DEFAULT },
+    { "for", TokenClass::T_FOR },
+    { "while", TokenClass::T_WHILE },
+    { "return", TokenClass::T_RETURN },
+    { "break", TokenClass::T_BREAK },
+    { "continue", TokenClass::T_CONTINUE },
+    { "true", TokenClass::T_TRUE },
+    { "false", TokenClass::T_FALSE },
+    { "null", TokenClass::T_NULL },
+};
+
+// Perfect hash over the keyword table: the slot comes from the length, the first and the last
+// character of a word, with a multiplier searched at compile time so no two keywords collide.
+struct KeywordTable {
+    static constexpr size_t slots = 64;
+    static constexpr size_t count = sizeof(keywords) / sizeof(Keyword);
+
+    uint32_t seed = 0;
+    size_t longest = 0;
+    std::array<uint8_t, slots> entries {};   // index into keywords + 1, 0 marks an empty slot
+
+    static constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+        uint32_t mix = (static_cast<uint8_t>(text.front()) * seed) ^ (static_cast<uint8_t>(text.back()) * 31u) ^ (static_cast<uint32_t>(text.size()) * 7u);
+        return (mix ^ (mix >> 6)) & (slots - 1);
+    }
+
+    constexpr size_t slot(std::string_view text) const {
+        return hash(text, seed);
+    }
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    for (uint32_t seed = 1; seed < 10000; seed++) {
+        KeywordTable table;
+        table.seed = seed;
+        bool collides = false;
+
+        for (size_t i = 0; i < KeywordTable::count && !collides; i++) {
+            size_t slot = KeywordTable::hash(keywords[i].text, seed);
+
+            if (table.entries[slot] != 0)
+                collides = true;
+
+            table.entries[slot] = static_cast<uint8_t>(i + 1);
+            table.longest = std::max(table.longest, keywords[i].text.size());
+        }
+
+        if (!collides)
+            return table;
+    }
+
+    return KeywordTable {};
+}
+
+inline constexpr KeywordTable keywordTable = buildKeywordTable();
+
+static_assert(keywordTable.seed != 0, "No collision-free keyword hash found, grow KeywordTable::slots");
+
+// Token class of an identifier-shaped word, T_IDENTIFIER when it is not a keyword. Never allocates.
+constexpr TokenClass keywordClass(std::string_view word) {
+    if (word.empty() || word.size() > keywordTable.longest)
+        return TokenClass::T_IDENTIFIER;
+
+    uint8_t entry = keywordTable.entries[keywordTable.slot(word)];
+
+    if (entry != 0 && keywords[entry - 1].text == word)
+        return keywords[entry - 1].token;
+
+    return TokenClass::T_IDENTIFIER;
+}
+
+static_assert(keywordClass("elseif") == TokenClass::T_ELSEIF && keywordClass("elsif") == TokenClass::T_IDENTIFIER);
+
+#endif // KEYWORDS_GENESIS
@@ -1,39 +1,50 @@
-#include "./TokenClass.hpp"
-
-struct LexerException {
-    std::string message;
-    int line = 1;
-
-    std::string what() { return message; }
-};
+#ifndef LEXER_GENESIS
+#define LEXER_GENESIS
 
-class Lexer {
+#include "./TokenClass.hpp"
+#include "./Scanner.hpp"
+#include "./Keywords.hpp"
+#include "./Operators.hpp"
+#include "./TokenStream.hpp"
+#include "./TokenStore.hpp"
+#include "./Diagnostics.hpp"
+
+class Lexer : public TokenSource {
 private:
-    std::string sourceCode;
+    // Views the SourceBuffer being compiled, the buffer has to outlive the lexer and its tokens
+    std::string_view sourceCode;
     std::vector<TokenInstance> tokens;
-    int current = 0, line = 1;
-    std::unordered_map<std::string, TokenClass> tokenClasses = {
-        { "let", TokenClass::T_LET },
-        { "function", TokenClass::T_FUNCTION },
-        { "if", TokenClass::T_IF },
-        { "else", TokenClass::T_ELSE },
-        { "elseif", TokenClass::T_ELSEIF },
-        { "class", TokenClass::T_CLASS },
-        { "switch", TokenClass::T_SWITCH },
-        { "case", TokenClass::T_CASE },
-        { "default", TokenClass::T_DEFAULT },
-        { "for", TokenClass::T_FOR },
-        { "while", TokenClass::T_WHILE },
-        { "return", TokenClass::T_RETURN },
-        { "break", TokenClass::T_BREAK },
-        { "continue", TokenClass::T_CONTINUE },
-        { "true", TokenClass::T_TRUE },
-        { "false", TokenClass::T_FALSE },
-        { "null", TokenClass::T_NULL },
-    };
+    int current = 0;
+    const ScanFunctions& scan = scanFunctions();
+    Diagnostics problems;
+    SymbolCache symbols;
+    std::string digitBuffer;    // digits of a literal with '_' separators, without them
+    bool chunk = false;
+    int openQuote = -1;
 
 public:
-    Lexer(std::string source) : sourceCode(source) {}
+    // With `_symbols` every identifier and string token carries its Symbol from that interner
+    Lexer(std::string_view source, SymbolInterner* _symbols = nullptr) : sourceCode(source), symbols(_symbols) {}
+
+    // Problems are recorded and lexing carries on after them, nothing is ever thrown
+    void report(std::string message, int position) {
+        problems.report(Diagnostic::LEXER, std::move(message), sourceCode.substr(position, 1));
+    }
+
+    const Diagnostics& diagnostics() const {
+        return problems;
+    }
+
+    // For lexing one chunk of a larger source: a string still open at the end is not reported but
+    // left to the caller, who knows whether a later chunk closes it
+    void lexAsChunk() {
+        chunk = true;
+    }
+
+    // The opening quote of the string the chunk ended in, null if it did not end inside one
+    const char* openString() const {
+        return openQuote < 0 ? nullptr : sourceCode.data() + openQuote;
+    }
 
     bool atEnd() {
         return (current >= sourceCode.size());
@@ -44,11 +55,16 @@ public:
     }
 
     char at() {
-        return sourceCode[current];
+        return (atEnd() ? '\0' : sourceCode[current]);
     }
 
     char seek() {
-        return ((current + 1) > sourceCode.size() ? sourceCode[current + 1] : '\0');
+        return ((current + 1) < sourceCode.size() ? sourceCode[current + 1] : '\0');
+    }
+
+    // Adds a token whose lexeme runs from `start` up to and including the current character
+    void addToken(TokenClass type, int start) {
+        tokens.push_back(TokenInstance {type, sourceCode.substr(start, current - start + 1)});
     }
 
     bool next(char _next) {
@@ -79,177 +95,273 @@ public:
     }
 
     bool isDigit(char input) {
-        return (input >= '0' && input <= '9');
+        return hasCharClass(input, CC_DIGIT);
     }
 
     bool isAlpha(char input) {
-        return ((input >= 'a' && input <= 'z') || (input >= 'A' && input <= 'Z') || input == '_');
+        return hasCharClass(input, CC_ALPHA);
     }
 
     bool isAlphaNumeric(char input) {
-        return (isAlpha(input) || isDigit(input));
+        return hasCharClass(input, CC_IDENTIFIER);
+    }
+
+    const char* cursor() {
+        return sourceCode.data() + current;
+    }
+
+    const char* limit() {
+        return sourceCode.data() + sourceCode.size();
+    }
+
+    void moveTo(const char* position) {
+        current = position - sourceCode.data();
     }
 
     void parseString() {
+        int quote = current;
         advanceCurrent();
-        std::string str;
+        int start = current;
+
+        moveTo(scan.findByte(cursor(), limit(), '"'));
+
+        // Nothing after the quote can be lexed reliably, the rest of the input is dropped
+        if (atEnd()) {
+            if (chunk)
+                openQuote = quote;
+            else
+                report("Unterminated string literal...", quote);
 
-        if (at() == '"') {
-            tokens.push_back(TokenInstance{TokenClass::T_STRING, str});
             return;
         }
 
-        while (!atEnd()) {
-            char _char = at();
+        std::string_view text = sourceCode.substr(start, current - start);
+        tokens.push_back(TokenInstance {TokenClass::T_STRING, text, symbols.intern(text)});
+    }
 
-            if (_char == '"')
-                break;
+    bool isHexDigit(char input) {
+        return isDigit(input) || (static_cast<unsigned char>((input | 0x20) - 'a') < 6);
+    }
 
-            str += at();
-            advanceCurrent();
-        }
+    // Skips a run of digits that may be split into groups by single '_' separators (1_000_000).
+    // False when there is no digit at all or a separator is not followed by a digit.
+    bool skipDigitGroups(bool hex, bool& separated) {
+        while (true) {
+            const char* group = cursor();
+
+            if (hex) {
+                while (isHexDigit(at()))
+                    advanceCurrent();
+            }
+            else
+                moveTo(scan.skipDigits(cursor(), limit()));
+
+            if (cursor() == group)
+                return false;
 
-        if (atEnd())
-            throw LexerException{"Unterminated string literal...", line};
+            if (at() != '_')
+                return true;
 
-        tokens.push_back(TokenInstance {TokenClass::T_STRING, str});
+            separated = true;
+            advanceCurrent();
+        }
     }
 
+    // Decimal integers (1_000), reals with a fraction and/or a signed exponent (1.5e-3) and hex
+    // integers (0xFF_FF). The value is decoded right here, once, and travels with the token.
     void parseNumber() {
-        std::string num;
+        int start = current;
+        bool hex = at() == '0' && (seek() == 'x' || seek() == 'X');
+        bool separated = false, real = false, valid;
 
-        while (!atEnd() && isDigit(at())) {
-            num += at();
-            advanceCurrent();
+        if (hex) {
+            current += 2;
+            valid = skipDigitGroups(true, separated);
         }
+        else {
+            valid = skipDigitGroups(false, separated);
 
-        if ((at() == 'e') || (at() == '.')){
-            num += at();
-            advanceCurrent();
+            // `1.` is a real too, a dot followed by a letter is left for a member access
+            if (valid && at() == '.' && !isAlpha(seek())) {
+                real = true;
+                advanceCurrent();
+
+                if (isDigit(at()))
+                    valid = skipDigitGroups(false, separated);
+            }
+
+            if (valid && (at() == 'e' || at() == 'E')) {
+                real = true;
+                advanceCurrent();
+
+                if (at() == '+' || at() == '-')
+                    advanceCurrent();
+
+                valid = skipDigitGroups(false, separated);
+            }
         }
 
-        while (!atEnd() && isDigit(at())) {
-            num += at();
-            advanceCurrent();
+        if (!valid) {
+            // The rest of a mangled literal like 1__0 or 0xZ goes with it, one problem is enough
+            moveTo(scan.skipIdentifier(cursor(), limit()));
+            report(format("Malformed number literal '%s'...", sourceCode.substr(start, current - start)), start);
         }
 
+        std::string_view text = sourceCode.substr(start, current - start);
         current--;
-        tokens.push_back(TokenInstance {TokenClass::T_NUMBER, num});
+
+        if (!valid) {
+            tokens.push_back(TokenInstance::fromInteger(text, 0));
+            return;
+        }
+
+        std::string_view digits = text.substr(hex ? 2 : 0);
+
+        if (separated) {
+            digitBuffer.clear();
+
+            for (char c : digits) {
+                if (c != '_')
+                    digitBuffer += c;
+            }
+
+            digits = digitBuffer;
+        }
+
+        const char* first = digits.data();
+        const char* last = first + digits.size();
+
+        if (!real) {
+            int64_t integer = 0;
+            auto result = std::from_chars(first, last, integer, hex ? 16 : 10);
+
+            if (result.ec == std::errc()) {
+                tokens.push_back(TokenInstance::fromInteger(text, integer));
+                return;
+            }
+
+            // Decimal integers too large for 64 bits are still fine as (rounded) reals
+            if (hex) {
+                report(format("Number literal '%s' does not fit in 64 bits...", text), start);
+                tokens.push_back(TokenInstance::fromInteger(text, 0));
+                return;
+            }
+        }
+
+        double number = 0;
+
+        if (std::from_chars(first, last, number).ec != std::errc())
+            report(format("Number literal '%s' is out of range...", text), start);
+
+        tokens.push_back(TokenInstance::fromReal(text, number));
     }
 
     void parseComment() {
         advanceCurrent();
-        while (!atEnd() && at() != '\n') {
-            advanceCurrent();
-        }
+        moveTo(scan.findByte(cursor(), limit(), '\n'));
 
+        // Stops on the last comment character, scanToken() steps past it
         current--;
     }
 
     void parseIdentifier() {
-        std::string id;
+        int start = current;
 
-        while (!atEnd() && isAlphaNumeric(at())) {
-            id += at();
-            advanceCurrent();
-        }
+        moveTo(scan.skipIdentifier(cursor(), limit()));
 
         current--;
-        if (tokenClasses.find(id) != tokenClasses.end())
-            tokens.push_back(TokenInstance {tokenClasses[id], id});
-        else
-            tokens.push_back(TokenInstance {TokenClass::T_IDENTIFIER, id});
+
+        std::string_view text = sourceCode.substr(start, current - start + 1);
+        TokenClass type = keywordClass(text);
+
+        tokens.push_back(TokenInstance {type, text, type == TokenClass::T_IDENTIFIER ? symbols.intern(text) : noSymbol});
     }
 
-    std::vector<TokenInstance> compile() {
-        while (!atEnd()) {
-            char _current = sourceCode.at(current);
+    // Lexes until at least one token was produced or the input ends
+    void scanToken() {
+        size_t produced = tokens.size();
+
+        while (!atEnd() && tokens.size() == produced) {
+            char _current = sourceCode[current];
+            int start = current;
 
             switch (_current) {
-            case '(':
-                tokens.push_back({TokenClass::T_LEFTPAREN, "("});
-                break;
-            case ')':
-                tokens.push_back( {TokenClass::T_RIGHTPAREN, "("});
-                break;
-            case '{':
-                tokens.push_back( {TokenClass::T_LEFTBRACE, "}"});
-                break;
-            case '}':
-                tokens.push_back( {TokenClass::T_RIGHTBRACE, "}"});
-                break;
-            case '[':
-                tokens.push_back( {TokenClass::T_LEFTBRACK, "["});
-                break;
-            case ']':
-                tokens.push_back( {TokenClass::T_RIGHTBRACK, "]"});
-                break;
-            case ',':
-                tokens.push_back( {TokenClass::T_COMMA, ","});
-                break;
-            case '.':
-                tokens.push_back( {TokenClass::T_DOT, "."});
-                break;
-            case ':':
-                tokens.push_back( {TokenClass::T_COLON, ":"});
-                break;
-            case ';':
-                tokens.push_back( {TokenClass::T_SEMICOLON, ";"});
-                break;
             case '\n':
-                line++;
-                break;
             case ' ':
             case '\t':
             case '\r':
             case '\b':
             case '\0':
-                break;
-            case '-':
-                tokens.push_back( {TokenClass::T_MINUS, "-"});
-                break;
-            case '+':
-                tokens.push_back( {TokenClass::T_PLUS, "+"});
+                // Line breaks and indentation come in long runs, skip all of it at once
+                moveTo(scan.skipSpaces(cursor(), limit()) - 1);
                 break;
             case '/':
                 if (next('/'))
-                    parseComment(); 
+                    parseComment();
                 else
-                    tokens.push_back( {TokenClass::T_SLASH, "/"});
+                    addToken(TokenClass::T_SLASH, start);
 
-                break;
-            case '*':
-                tokens.push_back( {TokenClass::T_STAR, "*"});
-                break;
-            case '!':
-                tokens.push_back( ((next('=')) ? TokenInstance{TokenClass::T_NOTEQUAL, "!="} : TokenInstance{TokenClass::T_BANG, "!"}));
-                break;
-            case '=':
-                tokens.push_back( ((next('=')) ? TokenInstance{TokenClass::T_EQUALEQUAL, "=="} : TokenInstance{TokenClass::T_EQUAL, "="}));
-                break;
-            case '<':
-                tokens.push_back( ((next('=')) ? TokenInstance{TokenClass::T_LESSEQUAL, "<="} : TokenInstance{TokenClass::T_LESS, "<"}));
-                break;
-            case '>':
-                tokens.push_back( ((next('=')) ? TokenInstance{TokenClass::T_GREATEREQUAL, ">="} : TokenInstance{TokenClass::T_GREATER, ">"}));
                 break;
             case '"':
                 parseString();
                 break;
             default:
-                if (isDigit(_current))
+                // Punctuation and operators come from the rules genesis::lex() shares
+                if (OperatorMatch match = matchOperator(_current, seek()); match.length) {
+                    current += match.length - 1;
+                    addToken(match.token, start);
+                }
+                else if (isDigit(_current))
                     parseNumber();
                 else if (isAlpha(_current))
                     parseIdentifier();
                 else
-                    throw LexerException{format("Unknown character '%c' found while reading file...", {_current}), line};
-                    
+                    report(format("Unknown character '%c' found while reading file...", _current), start);
+
                 break;
             }
 
             advanceCurrent();
         }
+    }
+
+    // Streaming entry point, only one batch of tokens is held at a time
+    size_t fill(TokenInstance* out, size_t max) override {
+        tokens.clear();
+
+        while (!atEnd() && tokens.size() < max)
+            scanToken();
+
+        std::copy(tokens.begin(), tokens.end(), out);
+        return tokens.size();
+    }
+
+    // Lexes the whole input into the compact struct-of-arrays store
+    TokenStore compileStore() {
+        TokenStore store(sourceCode, symbols.enabled());
+
+        if (sourceCode.size() > TokenStore::maxSourceSize) {
+            report("Source is too large for a token store...", 0);
+            return store;
+        }
+
+        TokenInstance batch[TokenStream::capacity];
+
+        while (size_t count = fill(batch, TokenStream::capacity)) {
+            for (size_t i = 0; i < count; i++)
+                store.push(batch[i]);
+        }
 
-        return tokens;
+        return store;
     }
-};
\ No newline at end of file
+
+    // Convenience wrapper that lexes the whole input at once
+    std::vector<TokenInstance> compile() {
+        while (!atEnd())
+            scanToken();
+
+        return std::move(tokens);
+    }
+};
+
+#endif // LEXER_GENESIS
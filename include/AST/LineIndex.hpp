@@ -0,0 +1,57 @@
+#ifndef LINE_INDEX_GENESIS
+#define LINE_INDEX_GENESIS
+
+#include "./Scanner.hpp"
+#include "../Util/Source.hpp"
+
+// 1-based, the column counts bytes
+struct SourceLocation {
+    uint32_t line = 1;
+    uint32_t column = 1;
+};
+
+// Maps byte offsets to lines and columns. Nothing in the lexing or parsing hot paths tracks lines,
+// the newline positions are only gathered (with the vector findByte scan) the first time a
+// diagnostic or a tool actually asks for a location.
+class LineIndex {
+private:
+    std::string_view source;
+    std::vector<uint32_t> lineStarts;
+
+    void build() {
+        const ScanFunctions& scan = scanFunctions();
+        const char* begin = source.data();
+        const char* end = begin + source.size();
+
+        lineStarts.push_back(0);
+
+        for (const char* at = scan.findByte(begin, end, '\n'); at != end; at = scan.findByte(at + 1, end, '\n'))
+            lineStarts.push_back(static_cast<uint32_t>(at + 1 - begin));
+    }
+
+public:
+    LineIndex(std::string_view _source) : source(_source) {}
+
+    SourceLocation locate(size_t offset) {
+        if (lineStarts.empty())
+            build();
+
+        auto line = std::upper_bound(lineStarts.begin(), lineStarts.end(), static_cast<uint32_t>(offset)) - 1;
+
+        return SourceLocation { static_cast<uint32_t>(line - lineStarts.begin() + 1), static_cast<uint32_t>(offset - *line + 1) };
+    }
+
+    // Location of a lexeme viewing the indexed source
+    SourceLocation locate(std::string_view lexeme) {
+        return locate(lexeme.data() - source.data());
+    }
+
+    size_t lineCount() {
+        if (lineStarts.empty())
+            build();
+
+        return lineStarts.size();
+    }
+};
+
+#endif // LINE_INDEX_GENESIS
@@ -0,0 +1,41 @@
+#ifndef OPERATORS_GENESIS
+#define OPERATORS_GENESIS
+
+#include "./TokenClass.hpp"
+
+// A punctuation or operator token and how many characters it takes
+struct OperatorMatch {
+    TokenClass token;
+    uint8_t length;
+};
+
+// Punctuation and operators, the tokens spelled with one or two fixed characters. `second` is the
+// character after `first` ('\0' at the end of the input). A length of 0 means `first` starts no
+// such token. `//` starts a comment and has to be checked for before this.
+constexpr OperatorMatch matchOperator(char first, char second) {
+    switch (first) {
+        case '(': return { TokenClass::T_LEFTPAREN, 1 };
+        case ')': return { TokenClass::T_RIGHTPAREN, 1 };
+        case '{': return { TokenClass::T_LEFTBRACE, 1 };
+        case '}': return { TokenClass::T_RIGHTBRACE, 1 };
+        case '[': return { TokenClass::T_LEFTBRACK, 1 };
+        case ']': return { TokenClass::T_RIGHTBRACK, 1 };
+        case ',': return { TokenClass::T_COMMA, 1 };
+        case '.': return { TokenClass::T_DOT, 1 };
+        case ':': return { TokenClass::T_COLON, 1 };
+        case ';': return { TokenClass::T_SEMICOLON, 1 };
+        case '-': return { TokenClass::T_MINUS, 1 };
+        case '+': return { TokenClass::T_PLUS, 1 };
+        case '/': return { TokenClass::T_SLASH, 1 };
+        case '*': return { TokenClass::T_STAR, 1 };
+        case '!': return second == '=' ? OperatorMatch { TokenClass::T_NOTEQUAL, 2 } : OperatorMatch { TokenClass::T_BANG, 1 };
+        case '=': return second == '=' ? OperatorMatch { TokenClass::T_EQUALEQUAL, 2 } : OperatorMatch { TokenClass::T_EQUAL, 1 };
+        case '<': return second == '=' ? OperatorMatch { TokenClass::T_LESSEQUAL, 2 } : OperatorMatch { TokenClass::T_LESS, 1 };
+        case '>': return second == '=' ? OperatorMatch { TokenClass::T_GREATEREQUAL, 2 } : OperatorMatch { TokenClass::T_GREATER, 1 };
+        default: return { TokenClass::T_NONE, 0 };
+    }
+}
+
+static_assert(matchOperator('<', '=').token == TokenClass::T_LESSEQUAL && matchOperator('<', ' ').length == 1 && matchOperator('a', '=').length == 0);
+
+#endif // OPERATORS_GENESIS
@@ -0,0 +1,353 @@
+#ifndef OPTIMIZER_GENESIS
+#define OPTIMIZER_GENESIS
+
+#include "Traversal.hpp"
+#include <charconv>
+#include <cmath>
+
+// Base of every optimization pass. rewrite() walks the tree children first without recursion
+// and visits every node once its children were already replaced. Each visit leaves the node that
+// replaces the visited one in `result`, the defaults keep the node itself. Replacement nodes come
+// from the same Arena as the tree.
+class RewritePass : public Visit {
+protected:
+    Arena& arena;
+    Statement* result = nullptr;
+    TreeWalk walk;
+
+public:
+    size_t rewrites = 0;
+
+    RewritePass(Arena& _arena) : arena(_arena) {}
+    virtual ~RewritePass() = default;
+
+    virtual const char* name() = 0;
+
+    Statement* rewrite(Statement* root) {
+        walk.postOrder(root, [&](Statement*& node) {
+            node->accept(*this);
+            node = result;
+        });
+
+        return root;
+    }
+
+    void visit(Expression& node) { result = &node; }
+    void visit(LiteralValue& node) { result = &node; }
+    void visit(Binary& node) { result = &node; }
+    void visit(Unary& node) { result = &node; }
+    void visit(Grouping& node) { result = &node; }
+    void visit(Let& node) { result = &node; }
+};
+
+// Drops parentheses, precedence is already encoded in the shape of the tree
+class GroupingElimination : public RewritePass {
+public:
+    using RewritePass::RewritePass;
+    using RewritePass::visit;
+
+    const char* name() { return "grouping-elimination"; }
+
+    void visit(Grouping& node) {
+        result = node.expression;
+        rewrites++;
+    }
+};
+
+// Evaluates operators whose operands are all literals
+class ConstantFolding : public RewritePass {
+private:
+    static LiteralValue* literal(Statement* node) {
+        return nodeCast<LiteralValue>(node);
+    }
+
+    static bool number(LiteralValue* node, double& value) {
+        if (!node || node->token.token != TokenClass::T_NUMBER)
+            return false;
+
+        value = node->token.number();
+        return true;
+    }
+
+    static bool truthy(LiteralValue* node) {
+        return !(node->token.token == TokenClass::T_NULL || node->token.token == TokenClass::T_FALSE);
+    }
+
+    static bool equal(LiteralValue* left, LiteralValue* right) {
+        double a, b;
+
+        if (number(left, a) && number(right, b))
+            return a == b;
+
+        return left->token.token == right->token.token && (left->token.token != TokenClass::T_STRING || sameLexeme(left->token, right->token));
+    }
+
+    Statement* makeNumber(double value) {
+        char buffer[32];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+
+        return arena.make<LiteralValue>(TokenInstance::fromReal(arena.copy(std::string_view(buffer, end - buffer)), value));
+    }
+
+    Statement* makeBool(bool value) {
+        return arena.make<LiteralValue>(value ? TokenInstance { TokenClass::T_TRUE, "true" } : TokenInstance { TokenClass::T_FALSE, "false" });
+    }
+
+    Statement* fold(TokenClass op, LiteralValue* left, LiteralValue* right) {
+        double a, b;
+        bool numbers = number(left, a) && number(right, b);
+
+        switch (op) {
+            case TokenClass::T_EQUALEQUAL: return makeBool(equal(left, right));
+            case TokenClass::T_NOTEQUAL: return makeBool(!equal(left, right));
+            default: break;
+        }
+
+        if (op == TokenClass::T_PLUS && left->token.token == TokenClass::T_STRING && right->token.token == TokenClass::T_STRING) {
+            std::string joined = std::string(left->token.value) + std::string(right->token.value);
+            return arena.make<LiteralValue>(TokenInstance { TokenClass::T_STRING, arena.copy(joined) });
+        }
+
+        if (!numbers)
+            return nullptr;
+
+        double value;
+
+        switch (op) {
+            case TokenClass::T_PLUS: value = a + b; break;
+            case TokenClass::T_MINUS: value = a - b; break;
+            case TokenClass::T_STAR: value = a * b; break;
+            case TokenClass::T_SLASH: value = a / b; break;
+            case TokenClass::T_LESS: return makeBool(a < b);
+            case TokenClass::T_LESSEQUAL: return makeBool(a <= b);
+            case TokenClass::T_GREATER: return makeBool(a > b);
+            case TokenClass::T_GREATEREQUAL: return makeBool(a >= b);
+            default: return nullptr;
+        }
+
+        // inf and nan have no literal spelling, those stay for the runtime
+        return std::isfinite(value) ? makeNumber(value) : nullptr;
+    }
+
+public:
+    using RewritePass::RewritePass;
+    using RewritePass::visit;
+
+    const char* name() { return "constant-folding"; }
+
+    void visit(Binary& node) {
+        RewritePass::visit(node);
+
+        LiteralValue* left = literal(node.left);
+        LiteralValue* right = literal(node.right);
+
+        if (!left || !right || left->token.token == TokenClass::T_IDENTIFIER || right->token.token == TokenClass::T_IDENTIFIER)
+            return;
+
+        if (Statement* folded = fold(node.op.token, left, right)) {
+            result = folded;
+            rewrites++;
+        }
+    }
+
+    void visit(Unary& node) {
+        RewritePass::visit(node);
+
+        LiteralValue* operand = literal(node.right);
+        double value;
+
+        if (!operand || operand->token.token == TokenClass::T_IDENTIFIER)
+            return;
+
+        if (node.op.token == TokenClass::T_BANG)
+            result = makeBool(!truthy(operand));
+        else if (node.op.token == TokenClass::T_MINUS && number(operand, value))
+            result = makeNumber(-value);
+        else
+            return;
+
+        rewrites++;
+    }
+};
+
+// x * 1, 1 * x, x / 1, x - 0 and !!x. An identity only fires when the operand is known to be a
+// number (or a boolean for !!), so it can never hide a runtime type error. x + 0 is left alone,
+// it turns -0 into 0.
+class AlgebraicSimplification : public RewritePass {
+private:
+    static bool isLiteral(Statement* node, double expected) {
+        auto literal = nodeCast<LiteralValue>(node);
+        // A folded -0 is not the 0 of x - 0
+        return literal && literal->token.token == TokenClass::T_NUMBER && literal->token.number() == expected
+            && std::signbit(literal->token.number()) == std::signbit(expected);
+    }
+
+    // A sum is numeric once any of its operands is, the operands of long + chains are searched
+    // with a worklist rather than recursion
+    static bool isNumeric(Statement* root) {
+        std::vector<Statement*> pending { root };
+
+        while (!pending.empty()) {
+            Statement* node = pending.back();
+            pending.pop_back();
+
+            if (auto literal = nodeCast<LiteralValue>(node)) {
+                if (literal->token.token == TokenClass::T_NUMBER)
+                    return true;
+            }
+            else if (auto binary = nodeCast<Binary>(node)) {
+                switch (binary->op.token) {
+                    case TokenClass::T_MINUS:
+                    case TokenClass::T_STAR:
+                    case TokenClass::T_SLASH:
+                        return true;
+                    case TokenClass::T_PLUS:
+                        pending.push_back(binary->right);
+                        pending.push_back(binary->left);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            else if (auto unary = nodeCast<Unary>(node)) {
+                if (unary->op.token == TokenClass::T_MINUS)
+                    return true;
+            }
+            else if (auto grouping = nodeCast<Grouping>(node))
+                pending.push_back(grouping->expression);
+        }
+
+        return false;
+    }
+
+    static bool isBoolean(Statement* node) {
+        while (auto grouping = nodeCast<Grouping>(node))
+            node = grouping->expression;
+
+        if (auto literal = nodeCast<LiteralValue>(node))
+            return literal->token.token == TokenClass::T_TRUE || literal->token.token == TokenClass::T_FALSE;
+
+        if (auto binary = nodeCast<Binary>(node)) {
+            switch (binary->op.token) {
+                case TokenClass::T_EQUALEQUAL:
+                case TokenClass::T_NOTEQUAL:
+                case TokenClass::T_LESS:
+                case TokenClass::T_LESSEQUAL:
+                case TokenClass::T_GREATER:
+                case TokenClass::T_GREATEREQUAL:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        if (auto unary = nodeCast<Unary>(node))
+            return unary->op.token == TokenClass::T_BANG;
+
+        return false;
+    }
+
+public:
+    using RewritePass::RewritePass;
+    using RewritePass::visit;
+
+    const char* name() { return "algebraic-simplification"; }
+
+    void visit(Binary& node) {
+        RewritePass::visit(node);
+        Statement* kept = nullptr;
+
+        switch (node.op.token) {
+            case TokenClass::T_STAR:
+                if (isLiteral(node.right, 1) && isNumeric(node.left))
+                    kept = node.left;
+                else if (isLiteral(node.left, 1) && isNumeric(node.right))
+                    kept = node.right;
+                break;
+            case TokenClass::T_SLASH:
+                if (isLiteral(node.right, 1) && isNumeric(node.left))
+                    kept = node.left;
+                break;
+            case TokenClass::T_MINUS:
+                if (isLiteral(node.right, 0) && isNumeric(node.left))
+                    kept = node.left;
+                break;
+            default:
+                break;
+        }
+
+        if (kept) {
+            result = kept;
+            rewrites++;
+        }
+    }
+
+    void visit(Unary& node) {
+        RewritePass::visit(node);
+
+        auto inner = nodeCast<Unary>(node.right);
+
+        if (node.op.token == TokenClass::T_BANG && inner && inner->op.token == TokenClass::T_BANG && isBoolean(inner->right)) {
+            result = inner->right;
+            rewrites++;
+        }
+    }
+};
+
+struct OptimizerReport {
+    size_t nodesBefore = 0;
+    size_t nodesAfter = 0;
+    std::vector<std::pair<const char*, size_t>> rewrites;   // per pass
+
+    size_t removed() const {
+        return nodesBefore - nodesAfter;
+    }
+};
+
+// Runs a pipeline of passes over a compilation unit, by default grouping elimination,
+// constant folding and algebraic simplification in that order
+class Optimizer {
+private:
+    std::vector<std::unique_ptr<RewritePass>> passes;
+
+    static size_t countNodes(std::vector<Statement*>& statements) {
+        TreeWalk walk;
+        size_t count = 0;
+
+        for (auto& statement : statements)
+            walk.postOrder(statement, [&](Statement*&) { count++; });
+
+        return count;
+    }
+
+public:
+    Optimizer(Arena& arena, bool defaults = true) {
+        if (!defaults)
+            return;
+
+        add(std::make_unique<GroupingElimination>(arena));
+        add(std::make_unique<ConstantFolding>(arena));
+        add(std::make_unique<AlgebraicSimplification>(arena));
+    }
+
+    void add(std::unique_ptr<RewritePass> pass) {
+        passes.push_back(std::move(pass));
+    }
+
+    OptimizerReport run(std::vector<Statement*>& statements) {
+        OptimizerReport report;
+        report.nodesBefore = countNodes(statements);
+
+        for (auto& pass : passes) {
+            for (auto& statement : statements)
+                statement = pass->rewrite(statement);
+
+            report.rewrites.push_back({pass->name(), pass->rewrites});
+        }
+
+        report.nodesAfter = countNodes(statements);
+        return report;
+    }
+};
+
+#endif // OPTIMIZER_GENESIS
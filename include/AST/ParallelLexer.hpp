@@ -0,0 +1,165 @@
+#ifndef PARALLEL_LEXER_GENESIS
+#define PARALLEL_LEXER_GENESIS
+
+#include "./Lexer.hpp"
+#include <atomic>
+#include <thread>
+
+// Lexes one large source on several threads. The source is cut into chunks right after line
+// breaks; there only a string can be open, since comments end at the line break and no other
+// token spans one. Not knowing which it is, every chunk is lexed twice at the same time: once
+// from its first byte (outside a string) and once from just after its first quote (inside a string
+// that started earlier). The chunks are then stitched in order, each taking the variant matching
+// the state the previous one ended in, and strings running across chunks are put back together.
+//
+// Tokens, positions and diagnostics are the same as those of a single Lexer over the whole source.
+// With an interner, it has to be safe to use from several threads (ConcurrentSymbolTable).
+class ParallelLexer {
+public:
+    // Smaller chunks are not worth a thread
+    static constexpr size_t minimumChunk = 1 << 20;
+
+private:
+    struct Variant {
+        TokenStore tokens;
+        Diagnostics problems;
+        const char* openQuote = nullptr;    // string still open at the end of the chunk
+        const char* closeQuote = nullptr;   // inside variant: the quote that ended the earlier string
+
+        Variant(TokenStore _tokens) : tokens(std::move(_tokens)) {}
+    };
+
+    struct Chunk {
+        std::string_view text;
+        Variant outside, inside;
+    };
+
+    std::string_view sourceCode;
+    SymbolInterner* interner;
+    size_t threads;
+    Diagnostics problems;
+
+    void lex(std::string_view text, Variant& variant) {
+        Lexer lexer(text, interner);
+        lexer.lexAsChunk();
+
+        TokenInstance batch[TokenStream::capacity];
+
+        while (size_t count = lexer.fill(batch, TokenStream::capacity)) {
+            for (size_t i = 0; i < count; i++)
+                variant.tokens.push(batch[i]);
+        }
+
+        variant.problems = lexer.diagnostics();
+        variant.openQuote = lexer.openString();
+    }
+
+    void lexInside(Chunk& chunk) {
+        const char* end = chunk.text.data() + chunk.text.size();
+        const char* quote = scanFunctions().findByte(chunk.text.data(), end, '"');
+
+        // The whole chunk is string content
+        if (quote == end)
+            return;
+
+        chunk.inside.closeQuote = quote;
+        lex(std::string_view(quote + 1, end - quote - 1), chunk.inside);
+    }
+
+    std::vector<Chunk> split(size_t count) {
+        std::vector<Chunk> chunks;
+        size_t start = 0;
+
+        for (size_t i = 1; i <= count && start < sourceCode.size(); i++) {
+            size_t end = sourceCode.size();
+
+            if (i < count) {
+                end = sourceCode.find('\n', std::max(start, sourceCode.size() / count * i));
+                end = (end == std::string_view::npos) ? sourceCode.size() : end + 1;
+            }
+
+            chunks.push_back(Chunk { sourceCode.substr(start, end - start), Variant { TokenStore(sourceCode, interner != nullptr) }, Variant { TokenStore(sourceCode, interner != nullptr) } });
+            start = end;
+        }
+
+        return chunks;
+    }
+
+public:
+    // `_threads` of 0 uses one per hardware thread
+    ParallelLexer(std::string_view source, SymbolInterner* _interner = nullptr, size_t _threads = 0) : sourceCode(source), interner(_interner), threads(_threads) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const Diagnostics& diagnostics() const {
+        return problems;
+    }
+
+    TokenStore compileStore() {
+        size_t count = std::max<size_t>(1, std::min(threads, sourceCode.size() / minimumChunk));
+
+        if (count == 1 || sourceCode.size() > TokenStore::maxSourceSize) {
+            Lexer lexer(sourceCode, interner);
+            TokenStore store = lexer.compileStore();
+
+            problems.append(lexer.diagnostics());
+            return store;
+        }
+
+        std::vector<Chunk> chunks = split(count);
+        std::atomic<size_t> next { 0 };
+
+        // Task 2i is the outside variant of chunk i and 2i + 1 its inside variant. The first chunk
+        // always starts outside a string.
+        auto work = [&]() {
+            for (size_t task = next++; task < 2 * chunks.size(); task = next++) {
+                Chunk& chunk = chunks[task / 2];
+
+                if (task % 2 == 0)
+                    lex(chunk.text, chunk.outside);
+                else if (task != 1)
+                    lexInside(chunk);
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for (size_t i = 1; i < std::min(threads, 2 * chunks.size()); i++)
+            workers.emplace_back(work);
+
+        work();
+
+        for (auto& worker : workers)
+            worker.join();
+
+        TokenStore store(sourceCode, interner != nullptr);
+        SymbolCache symbols(interner);
+        const char* openQuote = nullptr;
+
+        for (auto& chunk : chunks) {
+            Variant* variant = &chunk.outside;
+
+            if (openQuote) {
+                variant = &chunk.inside;
+
+                if (!variant->closeQuote)
+                    continue;
+
+                std::string_view text(openQuote + 1, variant->closeQuote - openQuote - 1);
+                store.push(TokenInstance { TokenClass::T_STRING, text, symbols.intern(text) });
+            }
+
+            store.append(variant->tokens);
+            problems.append(variant->problems);
+            openQuote = variant->openQuote;
+        }
+
+        if (openQuote)
+            problems.report(Diagnostic::LEXER, "Unterminated string literal...", std::string_view(openQuote, 1));
+
+        return store;
+    }
+};
+
+#endif // PARALLEL_LEXER_GENESIS
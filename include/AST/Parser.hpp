@@ -1,3 +1,6 @@
+#ifndef PARSER_GENESIS
+#define PARSER_GENESIS
+
 #include "TokenStatement.hpp"
 
 // Lower down = Greater precedence
@@ -15,175 +18,284 @@ enum Precedence {
     PREC_PRIMARY      // literals
 };
 
-struct ParserException {
-    std::string message;
+// Binding power of every token as a binary operator, PREC_NONE for anything that is not one
+constexpr std::array<uint8_t, static_cast<size_t>(TokenClass::T_NONE) + 1> precedenceTable = []() {
+    std::array<uint8_t, static_cast<size_t>(TokenClass::T_NONE) + 1> table {};
 
-    std::string what() { return message; }
-};
+    table[static_cast<size_t>(TokenClass::T_PLUS)] = PREC_TERM;
+    table[static_cast<size_t>(TokenClass::T_MINUS)] = PREC_TERM;
+    table[static_cast<size_t>(TokenClass::T_SLASH)] = PREC_FACTOR;
+    table[static_cast<size_t>(TokenClass::T_STAR)] = PREC_FACTOR;
+
+    table[static_cast<size_t>(TokenClass::T_EQUALEQUAL)] = PREC_EQUALITY;
+    table[static_cast<size_t>(TokenClass::T_NOTEQUAL)] = PREC_EQUALITY;
+
+    table[static_cast<size_t>(TokenClass::T_LESS)] = PREC_COMPARISON;
+    table[static_cast<size_t>(TokenClass::T_GREATER)] = PREC_COMPARISON;
+    table[static_cast<size_t>(TokenClass::T_LESSEQUAL)] = PREC_COMPARISON;
+    table[static_cast<size_t>(TokenClass::T_GREATEREQUAL)] = PREC_COMPARISON;
 
+    return table;
+}();
+
+constexpr int getPrecedence(TokenClass token) {
+    return precedenceTable[static_cast<size_t>(token)];
+}
+
+// Tokens are only ever handed out by reference into the stream, and nodes come from the arena,
+// so consuming a token never touches the heap.
+//
+// Errors never throw. The first problem in a statement is recorded, every parse function then
+// returns nullptr up to compile(), which skips ahead to the next ';' or '}' (panic mode) and
+// carries on with the statement after it, so one pass reports every broken statement.
 class Parser {
 private:
-    std::vector<TokenInstance> tokens;
-    std::vector<std::shared_ptr<Statement>> statements;
-    std::unordered_map<TokenClass, Precedence> precedences = {
-        {TokenClass::T_PLUS, Precedence::PREC_TERM},
-        {TokenClass::T_MINUS, Precedence::PREC_TERM},
-        {TokenClass::T_SLASH, Precedence::PREC_FACTOR},
-        {TokenClass::T_STAR, Precedence::PREC_FACTOR},
+    TokenStream tokens;
+    std::vector<Statement*> statements;
+    // Owns every node handed out by this parser, it has to outlive the returned statements
+    Arena& arena;
+    Diagnostics problems;
+
+    // An operator still waiting for its right operand, or a grouping whose ')' was not reached yet
+    struct Pending {
+        enum Kind : uint8_t { BINARY, UNARY, GROUPING } kind;
+        uint8_t precedence;
+        TokenInstance oper;
+    };
 
-        {TokenClass::T_EQUALEQUAL, Precedence::PREC_EQUALITY},
-        {TokenClass::T_NOTEQUAL, Precedence::PREC_EQUALITY},
+    std::vector<Pending> pending;
+    std::vector<Statement*> operands;
 
-        {TokenClass::T_LESS, Precedence::PREC_COMPARISON},
-        {TokenClass::T_GREATER, Precedence::PREC_COMPARISON},
-        {TokenClass::T_LESSEQUAL, Precedence::PREC_COMPARISON},
-        {TokenClass::T_GREATEREQUAL, Precedence::PREC_COMPARISON}};
+    // Records the problem at the current token and returns the nullptr every caller passes on
+    Statement* error(const char* expected) {
+        const TokenInstance& found = at();
 
-    int current = 0;
+        if (found.token == TokenClass::T_NONE)
+            problems.report(Diagnostic::PARSER, format("Expected %s but reached the end of the input...", expected), found.value);
+        else
+            problems.report(Diagnostic::PARSER, format("Expected %s but got '%s' instead...", expected, found.value), found.value);
+
+        return nullptr;
+    }
+
+    // Skips the rest of a broken statement, up to and including the next ';' or '}'
+    void synchronize() {
+        while (!atEnd()) {
+            TokenClass skipped = consume().token;
+
+            if (skipped == TokenClass::T_SEMICOLON || skipped == TokenClass::T_RIGHTBRACE)
+                return;
+        }
+    }
 
 public:
-    Parser(std::vector<TokenInstance> _tokens) : tokens(_tokens) {};
+    // Parses a token vector that has already been lexed, the vector has to outlive the parser
+    Parser(const std::vector<TokenInstance>& _tokens, Arena& _arena) : tokens(_tokens), arena(_arena) {};
+
+    // Pulls tokens from the lexer as it goes, the full token vector is never materialized
+    Parser(TokenSource& _source, Arena& _arena) : tokens(_source), arena(_arena) {};
 
     bool atEnd() {
-        return current >= tokens.size();
+        return tokens.atEnd();
     }
 
-    bool assert(TokenClass type) {
-        if (at().token != type) {
-            throw ParserException { format("Expected a different value but got '%s' instead...", { at().value }) };
-        }
+    // Tokens consumed so far
+    size_t position() const {
+        return tokens.position();
+    }
 
-        return true;
+    // Whether parsing needed more tokens than the input had
+    bool overran() const {
+        return tokens.overran();
     }
 
-     bool matches(TokenClass current, std::initializer_list<TokenClass> matched) {
-        for (auto i : matched) {
-            if (i == current)
-                return true;
-        }
+    const Diagnostics& diagnostics() const {
+        return problems;
+    }
 
-        return false;
-     }
+    template <typename... Classes>
+    static bool matches(TokenClass current, Classes... matched) {
+        return ((current == matched) || ...);
+    }
 
     void advanceCurrent() {
-        current++;
+        tokens.next();
     }
 
-    TokenInstance at() {
-        return tokens[current];
+    // Valid until the stream moves on
+    const TokenInstance& at() {
+        return tokens.peek();
     }
 
-    TokenInstance before() {
-        return tokens[current - 1];
+    // Valid until the next consume()
+    const TokenInstance& before() {
+        return tokens.last();
     }
 
-    TokenInstance consume() {
-        return tokens[current++];
+    const TokenInstance& consume() {
+        return tokens.next();
     }
 
-    int getPrecedence(TokenClass token) {
-        if (precedences.find(token) == precedences.end())
-            return PREC_NONE;
+    // Applies the binary operators on top of the stack that bind at least as tight as `precedence`
+    void reduce(int precedence) {
+        while (!pending.empty() && pending.back().kind == Pending::BINARY && pending.back().precedence >= precedence) {
+            Statement* rhs = operands.back();
+            operands.pop_back();
 
-        return (int) precedences.at(token);
+            operands.back() = arena.make<Binary>(operands.back(), rhs, pending.back().oper);
+            pending.pop_back();
+        }
     }
 
-    std::shared_ptr<Statement> binary(std::shared_ptr<Statement> lhs, int minPriority) {
-        // Gets the precedence for the current operator, if it doesnt exist, the priority is 0
-        int currentPriority = getPrecedence(at().token);
-
-        // Compare the current operator precedence with the minimum precedence
-        while (currentPriority >= minPriority) {
-            // Consume that operator
-            auto oper = consume();
-            // Get the precedence of the operator
-            auto operPriority = getPrecedence(oper.token);
-            // Evaluates the rhs of the operator as an expression
-            auto rhs = primary();
-
-            // Gets the current precedence of the operator
-            currentPriority = getPrecedence(at().token);
-
-            // Checks if the operator exists in the map
-            if (currentPriority == PREC_NONE) {
-                return std::make_shared<Binary>(lhs, rhs, oper);
+    // Shunting-yard over two explicit stacks, so nesting depth costs heap memory (kept between
+    // statements) and never call stack. Each operator first applies the ones before it that bind
+    // at least as tight, so equal precedences group to the left: 1 - 2 - 3 is ((1 - 2) - 3) and
+    // 1 + 2 * 3 is (1 + (2 * 3)). A '-' or '!' is only taken at the start of an expression or
+    // grouping and applies to the primary right after it. The expression ends at the first token
+    // that is not an operator, which has to be a ')' while a grouping is still open.
+    Statement* expression() {
+        pending.clear();
+        operands.clear();
+
+        bool start = true;
+
+        while (true) {
+            if (start && matches(at().token, TokenClass::T_MINUS, TokenClass::T_BANG))
+                pending.push_back(Pending { Pending::UNARY, PREC_NONE, consume() });
+
+            switch (at().token) {
+                case TokenClass::T_NUMBER:
+                case TokenClass::T_STRING:
+                case TokenClass::T_TRUE:
+                case TokenClass::T_FALSE:
+                case TokenClass::T_NULL:
+                case TokenClass::T_IDENTIFIER:
+                    operands.push_back(arena.make<LiteralValue>(consume()));
+                    break;
+                case TokenClass::T_LEFTPAREN:
+                    advanceCurrent();
+                    pending.push_back(Pending { Pending::GROUPING, PREC_NONE, TokenInstance() });
+                    start = true;
+                    continue;
+                default:
+                    return error("an expression");
             }
 
-            // Checks if the new operator precedence is greater than the previous, if it is then change rhs to a new Binary Expression (so precedence goes to rhs instead)
-            while (currentPriority >= getPrecedence(oper.token)) {
-                // Change rhs to the new Binary expression to rule precedence
-                rhs = binary(rhs, operPriority + (currentPriority > operPriority ? 1 : 0));
+            // An operand is complete: wrap it in its unary operator, then either take the next
+            // binary operator or end the innermost open grouping (or the whole expression)
+            while (true) {
+                if (!pending.empty() && pending.back().kind == Pending::UNARY) {
+                    operands.back() = arena.make<Unary>(operands.back(), pending.back().oper);
+                    pending.pop_back();
+                }
 
-                // Gets the current operator after rhs and replaces the old with it
-                currentPriority = getPrecedence(at().token);
+                int precedence = getPrecedence(at().token);
 
-                // Checks if the operator exists in the hashmap
-                if (currentPriority == PREC_NONE) {
+                if (precedence != PREC_NONE) {
+                    reduce(precedence);
+                    pending.push_back(Pending { Pending::BINARY, static_cast<uint8_t>(precedence), consume() });
                     break;
                 }
-            }
 
-            lhs = std::make_shared<Binary>(lhs, rhs, oper);
-        }
+                reduce(PREC_NONE);
 
-        return lhs;
-    }
+                if (pending.empty())
+                    return operands.back();
+
+                if (at().token != TokenClass::T_RIGHTPAREN)
+                    return error("')' after the expression");
 
-    std::shared_ptr<Statement> primary() {
-        switch (at().token) {
-            case TokenClass::T_NUMBER:
-            case TokenClass::T_STRING:
-            case TokenClass::T_TRUE:
-            case TokenClass::T_FALSE:
-            case TokenClass::T_NULL:
-            case TokenClass::T_IDENTIFIER:
-            {
+                pending.pop_back();
                 advanceCurrent();
-                return std::make_shared<LiteralValue>(before());
+                operands.back() = arena.make<Grouping>(operands.back());
             }
-            break;
+
+            start = false;
         }
+    }
 
-        if (at().token == TokenClass::T_LEFTPAREN) {
-            advanceCurrent();
-            std::shared_ptr<Statement> expr = expression();
-            advanceCurrent();
+    // let <identifier> = <expression>
+    Statement* let() {
+        advanceCurrent();
 
-            return std::make_shared<Grouping>(expr);
-        }
+        if (at().token != TokenClass::T_IDENTIFIER)
+            return error("a name after 'let'");
 
-        throw ParserException { format("Expected an expression but got '%s' instead...", { at().value }) };
-    }
+        TokenInstance name = consume();
 
-    std::shared_ptr<Statement> expression() {
-        std::optional<std::shared_ptr<Statement>> lhs = std::nullopt;
+        if (at().token != TokenClass::T_EQUAL)
+            return error("'=' after the name");
 
-        if (matches(at().token, {TokenClass::T_MINUS, TokenClass::T_BANG})) {
-            auto oper = consume();
-            auto rhs = primary();
+        advanceCurrent();
+        Statement* initializer = expression();
 
-            lhs = std::make_shared<Unary>(rhs, oper);
-        }
+        return initializer ? arena.make<Let>(name, initializer) : nullptr;
+    }
+
+    // nullptr once a problem was recorded
+    Statement* statement() {
+        if (at().token == TokenClass::T_LET)
+            return let();
 
-        if (!lhs) {
-            lhs = primary();
+        return expression();
+    }
+
+    // Takes the ';' after a statement, the end of the input ends the last one as well
+    bool endStatement() {
+        if (at().token == TokenClass::T_SEMICOLON) {
+            advanceCurrent();
+            return true;
         }
 
-        lhs = binary(*lhs, 1);
+        if (atEnd())
+            return true;
 
-        return *lhs;
+        error("';' after the statement");
+        return false;
     }
 
-    std::vector<std::shared_ptr<Statement>> compile() {
+    // Every statement that parsed, the broken ones are left out and described in diagnostics()
+    std::vector<Statement*> compile() {
         while (!atEnd()) {
-            std::shared_ptr<Statement> expr;
+            Statement* expr = statement();
 
-            expr = expression();
+            if (!expr || !endStatement()) {
+                synchronize();
+                continue;
+            }
 
             statements.push_back(expr);
-            advanceCurrent();
         }
 
         return statements;
     };
-};
\ No newline at end of file
+};
+
+// Tokens, tree and problems of one source, lexed and parsed in a single pass without exceptions
+struct ParseResult {
+    TokenStore tokens;
+    std::vector<Statement*> statements;
+    Diagnostics diagnostics;
+
+    bool ok() const {
+        return diagnostics.empty();
+    }
+};
+
+inline ParseResult parseSource(std::string_view source, Arena& arena) {
+    ParseResult result;
+    Lexer lexer(source);
+
+    result.tokens = lexer.compileStore();
+
+    TokenStoreReader reader(result.tokens);
+    Parser parser(reader, arena);
+
+    result.statements = parser.compile();
+    result.diagnostics.append(lexer.diagnostics());
+    result.diagnostics.append(parser.diagnostics());
+
+    return result;
+}
+
+#endif // PARSER_GENESIS
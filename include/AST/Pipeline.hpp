@@ -0,0 +1,135 @@
+#ifndef PIPELINE_GENESIS
+#define PIPELINE_GENESIS
+
+#include "./Parser.hpp"
+#include "../Util/SpscQueue.hpp"
+#include <exception>
+#include <thread>
+#include <utility>
+
+// Token source that lexes on a thread of its own, so a Parser pulling from it works on one part of
+// a file while the next part is still being lexed. Tokens travel in batches through an SpscQueue;
+// the lexer waits once it is `slotCount` batches ahead (back-pressure) and the parser waits when
+// it caught up. The lexer also fills the TokenStore on its side, and its diagnostics (or whatever
+// it threw) are handed over by finish() once the parser is done.
+class PipelinedLexer : public TokenSource {
+public:
+    static constexpr size_t batchCapacity = 512;
+    static constexpr size_t slotCount = 16;
+
+private:
+    struct Batch {
+        size_t count;
+        TokenInstance tokens[batchCapacity];
+    };
+
+    std::string_view source;
+    Lexer lexer;
+    TokenStore store;
+    std::unique_ptr<SpscQueue<Batch, slotCount>> queue = std::make_unique<SpscQueue<Batch, slotCount>>();
+    std::exception_ptr failure;
+    std::thread producer;
+
+    Batch* current = nullptr;
+    size_t offset = 0;
+
+    void produce() {
+        try {
+            if (source.size() > TokenStore::maxSourceSize)
+                lexer.report("Source is too large for a token store...", 0);
+            else {
+                while (Batch* batch = queue->acquire()) {
+                    batch->count = lexer.fill(batch->tokens, batchCapacity);
+
+                    if (batch->count == 0)
+                        break;
+
+                    for (size_t i = 0; i < batch->count; i++)
+                        store.push(batch->tokens[i]);
+
+                    queue->push();
+                }
+            }
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+
+        queue->close();
+    }
+
+public:
+    // Starts lexing right away, `_source` has to outlive the lexer and its tokens
+    PipelinedLexer(std::string_view _source, SymbolInterner* symbols = nullptr) : source(_source), lexer(_source, symbols), store(_source, symbols != nullptr) {
+        producer = std::thread([this]() { produce(); });
+    }
+
+    PipelinedLexer(const PipelinedLexer&) = delete;
+    PipelinedLexer& operator=(const PipelinedLexer&) = delete;
+
+    ~PipelinedLexer() {
+        if (producer.joinable()) {
+            queue->cancel();
+            producer.join();
+        }
+    }
+
+    size_t fill(TokenInstance* out, size_t max) override {
+        if (current && offset == current->count) {
+            queue->pop();
+            current = nullptr;
+        }
+
+        if (!current) {
+            current = queue->front();
+            offset = 0;
+
+            if (!current)
+                return 0;
+        }
+
+        size_t count = std::min(max, current->count - offset);
+        std::copy(current->tokens + offset, current->tokens + offset + count, out);
+        offset += count;
+
+        return count;
+    }
+
+    // Stops and waits for the lexer thread, rethrowing what it threw. The tokens and diagnostics
+    // below are only complete once the parser consumed everything before this is called.
+    void finish() {
+        if (producer.joinable()) {
+            queue->cancel();
+            producer.join();
+        }
+
+        if (failure)
+            std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+
+    const Diagnostics& diagnostics() const {
+        return lexer.diagnostics();
+    }
+
+    TokenStore& tokens() {
+        return store;
+    }
+};
+
+// parseSource() with the lexer running one step ahead of the parser on a second thread
+inline ParseResult parseSourcePipelined(std::string_view source, Arena& arena, SymbolInterner* symbols = nullptr) {
+    ParseResult result;
+    PipelinedLexer lexer(source, symbols);
+    Parser parser(lexer, arena);
+
+    result.statements = parser.compile();
+    lexer.finish();
+
+    result.tokens = std::move(lexer.tokens());
+    result.diagnostics.append(lexer.diagnostics());
+    result.diagnostics.append(parser.diagnostics());
+
+    return result;
+}
+
+#endif // PIPELINE_GENESIS
@@ -0,0 +1,123 @@
+#ifndef SCANNER_GENESIS
+#define SCANNER_GENESIS
+
+#include "CharClass.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GENESIS_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// Run scanners used by the Lexer. Each function returns the first position in [begin, end)
+// that no longer belongs to the run (or `end`). The x86 paths look at 16 (SSE2) or 32 (AVX2)
+// bytes per step and are picked once at startup, everything else uses the scalar loops.
+struct ScanFunctions {
+    const char* (*skipSpaces)(const char*, const char*);
+    const char* (*skipIdentifier)(const char*, const char*);
+    const char* (*skipDigits)(const char*, const char*);
+    const char* (*findByte)(const char*, const char*, char);
+    const char* name;
+};
+
+namespace ScalarScan {
+    inline const char* skipClass(const char* begin, const char* end, uint8_t charClass) {
+        while (begin < end && hasCharClass(*begin, charClass))
+            begin++;
+
+        return begin;
+    }
+
+    inline const char* skipSpaces(const char* begin, const char* end) {
+        return skipClass(begin, end, CC_SPACE);
+    }
+
+    inline const char* skipIdentifier(const char* begin, const char* end) {
+        return skipClass(begin, end, CC_IDENTIFIER);
+    }
+
+    inline const char* skipDigits(const char* begin, const char* end) {
+        return skipClass(begin, end, CC_DIGIT);
+    }
+
+    inline const char* findByte(const char* begin, const char* end, char byte) {
+        const void* found = std::memchr(begin, byte, end - begin);
+        return found ? static_cast<const char*>(found) : end;
+    }
+}
+
+#ifdef GENESIS_SCAN_X86
+#ifdef __SSE2__
+#define SCAN_NAMESPACE SSE2Scan
+#define SCAN_VECTOR __m128i
+#define SCAN_WIDTH 16
+#define SCAN_FULL 0xFFFFu
+#define SCAN_LOAD(at) _mm_loadu_si128(reinterpret_cast<const __m128i*>(at))
+#define SCAN_SPLAT(value) _mm_set1_epi8(value)
+#define SCAN_EQUAL(a, b) _mm_cmpeq_epi8(a, b)
+#define SCAN_GREATER(a, b) _mm_cmpgt_epi8(a, b)
+#define SCAN_AND(a, b) _mm_and_si128(a, b)
+#define SCAN_OR(a, b) _mm_or_si128(a, b)
+#define SCAN_MASK(a) static_cast<uint32_t>(_mm_movemask_epi8(a))
+#include "ScannerKernels.hpp"
+#endif
+
+// The AVX2 kernels are compiled for that target only, they are never called unless the CPU reports AVX2
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#define SCAN_NAMESPACE AVX2Scan
+#define SCAN_VECTOR __m256i
+#define SCAN_WIDTH 32
+#define SCAN_FULL 0xFFFFFFFFu
+#define SCAN_LOAD(at) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at))
+#define SCAN_SPLAT(value) _mm256_set1_epi8(value)
+#define SCAN_EQUAL(a, b) _mm256_cmpeq_epi8(a, b)
+#define SCAN_GREATER(a, b) _mm256_cmpgt_epi8(a, b)
+#define SCAN_AND(a, b) _mm256_and_si256(a, b)
+#define SCAN_OR(a, b) _mm256_or_si256(a, b)
+#define SCAN_MASK(a) static_cast<uint32_t>(_mm256_movemask_epi8(a))
+#include "ScannerKernels.hpp"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+// Picks the widest implementation the running CPU supports, GENESIS_SCAN=scalar|sse2|avx2 overrides it
+inline const ScanFunctions& scanFunctions() {
+    static const ScanFunctions selected = []() {
+        const char* forced = std::getenv("GENESIS_SCAN");
+        std::string_view choice = forced ? forced : "";
+
+        ScanFunctions scalar {ScalarScan::skipSpaces, ScalarScan::skipIdentifier, ScalarScan::skipDigits, ScalarScan::findByte, "scalar"};
+
+        if (choice == "scalar")
+            return scalar;
+
+#ifdef GENESIS_SCAN_X86
+        __builtin_cpu_init();
+
+        if (choice != "sse2" && __builtin_cpu_supports("avx2"))
+            return ScanFunctions {AVX2Scan::skipSpaces, AVX2Scan::skipIdentifier, AVX2Scan::skipDigits, AVX2Scan::findByte, "avx2"};
+
+#ifdef __SSE2__
+        return ScanFunctions {SSE2Scan::skipSpaces, SSE2Scan::skipIdentifier, SSE2Scan::skipDigits, SSE2Scan::findByte, "sse2"};
+#endif
+#endif
+
+        return scalar;
+    }();
+
+    return selected;
+}
+
+#endif // SCANNER_GENESIS
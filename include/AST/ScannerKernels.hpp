@@ -0,0 +1,87 @@
+// Vector kernels for Scanner.hpp. This file has no include guard on purpose: Scanner.hpp includes
+// it once per instruction set after defining the SCAN_* macros below, which are cleared again here.
+//
+// Every mask has a bit set for each byte that still belongs to the run, the first clear bit marks
+// where the run stops. Signed byte compares are fine since every byte >= 0x80 is negative and
+// therefore falls outside all of the ranges.
+namespace SCAN_NAMESPACE {
+    inline SCAN_VECTOR inRange(SCAN_VECTOR input, char low, char high) {
+        return SCAN_AND(SCAN_GREATER(input, SCAN_SPLAT(low - 1)), SCAN_GREATER(SCAN_SPLAT(high + 1), input));
+    }
+
+    inline uint32_t spaceMask(const char* at) {
+        SCAN_VECTOR input = SCAN_LOAD(at);
+
+        SCAN_VECTOR spaces = SCAN_OR(SCAN_EQUAL(input, SCAN_SPLAT(' ')), SCAN_OR(SCAN_EQUAL(input, SCAN_SPLAT('\t')), SCAN_EQUAL(input, SCAN_SPLAT('\n'))));
+        SCAN_VECTOR controls = SCAN_OR(SCAN_EQUAL(input, SCAN_SPLAT('\r')), SCAN_OR(SCAN_EQUAL(input, SCAN_SPLAT('\b')), SCAN_EQUAL(input, SCAN_SPLAT('\0'))));
+
+        return SCAN_MASK(SCAN_OR(spaces, controls));
+    }
+
+    inline uint32_t digitMask(const char* at) {
+        return SCAN_MASK(inRange(SCAN_LOAD(at), '0', '9'));
+    }
+
+    inline uint32_t identifierMask(const char* at) {
+        SCAN_VECTOR input = SCAN_LOAD(at);
+
+        // Setting bit 5 folds upper case onto lower case, no other byte lands in a-z that way
+        SCAN_VECTOR letters = inRange(SCAN_OR(input, SCAN_SPLAT(0x20)), 'a', 'z');
+        SCAN_VECTOR digits = inRange(input, '0', '9');
+
+        return SCAN_MASK(SCAN_OR(SCAN_OR(letters, digits), SCAN_EQUAL(input, SCAN_SPLAT('_'))));
+    }
+
+    template <uint32_t (*Mask)(const char*)>
+    inline const char* skipRun(const char* begin, const char* end, uint8_t charClass) {
+        while (end - begin >= SCAN_WIDTH) {
+            uint32_t stop = ~Mask(begin) & SCAN_FULL;
+
+            if (stop)
+                return begin + __builtin_ctz(stop);
+
+            begin += SCAN_WIDTH;
+        }
+
+        return ScalarScan::skipClass(begin, end, charClass);
+    }
+
+    inline const char* skipSpaces(const char* begin, const char* end) {
+        return skipRun<spaceMask>(begin, end, CC_SPACE);
+    }
+
+    inline const char* skipIdentifier(const char* begin, const char* end) {
+        return skipRun<identifierMask>(begin, end, CC_IDENTIFIER);
+    }
+
+    inline const char* skipDigits(const char* begin, const char* end) {
+        return skipRun<digitMask>(begin, end, CC_DIGIT);
+    }
+
+    inline const char* findByte(const char* begin, const char* end, char byte) {
+        SCAN_VECTOR needle = SCAN_SPLAT(byte);
+
+        while (end - begin >= SCAN_WIDTH) {
+            uint32_t found = SCAN_MASK(SCAN_EQUAL(SCAN_LOAD(begin), needle));
+
+            if (found)
+                return begin + __builtin_ctz(found);
+
+            begin += SCAN_WIDTH;
+        }
+
+        return ScalarScan::findByte(begin, end, byte);
+    }
+}
+
+#undef SCAN_NAMESPACE
+#undef SCAN_VECTOR
+#undef SCAN_WIDTH
+#undef SCAN_FULL
+#undef SCAN_LOAD
+#undef SCAN_SPLAT
+#undef SCAN_EQUAL
+#undef SCAN_GREATER
+#undef SCAN_AND
+#undef SCAN_OR
+#undef SCAN_MASK
@@ -0,0 +1,458 @@
+#ifndef STATIC_LEXER_GENESIS
+#define STATIC_LEXER_GENESIS
+
+#include "./CharClass.hpp"
+#include "./Keywords.hpp"
+#include "./Operators.hpp"
+#include <limits>
+#include <stdexcept>
+
+// Lexing of Genesis snippets embedded in C++ as string literals, at compile time:
+//
+//     constexpr auto tokens = genesis::lex("let limit = 0x400;");
+//
+// The character classes, the keyword table and the operator rules are the ones Lexer uses, and
+// the tokens (classes, lexemes and decoded numbers) are the same it produces. A problem Lexer
+// would report stops the build instead, the failing throw below names it. Called at run time, the
+// same problems throw std::invalid_argument.
+namespace genesis {
+    // A token that lives in a constant. Its lexeme views the string literal it was lexed from.
+    struct StaticToken {
+        TokenClass token = TokenClass::T_NONE;
+        NumberKind numberKind = NumberKind::NONE;
+        std::string_view value;
+        int64_t integer = 0;
+        double real = 0;
+
+        // As the Lexer would have produced it, without a symbol
+        TokenInstance instance() const {
+            switch (numberKind) {
+                case NumberKind::INTEGER: return TokenInstance::fromInteger(value, integer);
+                case NumberKind::REAL: return TokenInstance::fromReal(value, real);
+                default: return TokenInstance { token, value };
+            }
+        }
+    };
+
+    template <size_t Capacity>
+    struct StaticTokens {
+        std::array<StaticToken, Capacity> tokens {};
+        size_t count = 0;
+
+        constexpr size_t size() const { return count; }
+        constexpr const StaticToken& operator[](size_t index) const { return tokens[index]; }
+        constexpr const StaticToken* begin() const { return tokens.data(); }
+        constexpr const StaticToken* end() const { return tokens.data() + count; }
+
+        // For a Parser, which takes a vector of tokens
+        std::vector<TokenInstance> instances() const {
+            std::vector<TokenInstance> result;
+            result.reserve(count);
+
+            for (size_t i = 0; i < count; i++)
+                result.push_back(tokens[i].instance());
+
+            return result;
+        }
+    };
+
+    // Unsigned integer of up to 4096 bits, enough to round any decimal literal exactly
+    struct BigNumber {
+        std::array<uint32_t, 128> words {};
+        size_t size = 0;    // words in use, the top one is never 0
+
+        constexpr void trim() {
+            while (size && words[size - 1] == 0)
+                size--;
+        }
+
+        constexpr void grow(size_t count) {
+            if (count > words.size())
+                throw std::invalid_argument("Number literal in a Genesis snippet is too long");
+        }
+
+        // this * factor + addend
+        constexpr void multiplyAdd(uint32_t factor, uint32_t addend) {
+            uint64_t carry = addend;
+
+            for (size_t i = 0; i < size; i++) {
+                carry += uint64_t(words[i]) * factor;
+                words[i] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+
+            if (carry) {
+                grow(size + 1);
+                words[size++] = static_cast<uint32_t>(carry);
+            }
+        }
+
+        constexpr void multiplyPowerOfTen(int exponent) {
+            for (; exponent >= 9; exponent -= 9)
+                multiplyAdd(1000000000, 0);
+
+            uint32_t rest = 1;
+
+            for (; exponent > 0; exponent--)
+                rest *= 10;
+
+            multiplyAdd(rest, 0);
+        }
+
+        constexpr void shiftLeft(size_t bits) {
+            if (size == 0)
+                return;
+
+            size_t whole = bits / 32, part = bits % 32;
+            grow(size + whole + 1);
+
+            for (size_t i = size + whole + 1; i-- > 0;) {
+                uint64_t high = i >= whole && i - whole < size ? words[i - whole] : 0;
+                uint64_t low = i >= whole + 1 && i - whole - 1 < size ? words[i - whole - 1] : 0;
+                words[i] = static_cast<uint32_t>((high << part) | (low >> (32 - part)));
+            }
+
+            size += whole + 1;
+            trim();
+        }
+
+        constexpr void shiftRightOne() {
+            for (size_t i = 0; i < size; i++)
+                words[i] = (words[i] >> 1) | (i + 1 < size ? words[i + 1] << 31 : 0);
+
+            trim();
+        }
+
+        constexpr size_t bitLength() const {
+            size_t length = size ? (size - 1) * 32 : 0;
+
+            for (uint32_t top = size ? words[size - 1] : 0; top; top >>= 1)
+                length++;
+
+            return length;
+        }
+
+        constexpr int compare(const BigNumber& other) const {
+            if (size != other.size)
+                return size < other.size ? -1 : 1;
+
+            for (size_t i = size; i-- > 0;) {
+                if (words[i] != other.words[i])
+                    return words[i] < other.words[i] ? -1 : 1;
+            }
+
+            return 0;
+        }
+
+        // this - other, which must not be larger
+        constexpr void subtract(const BigNumber& other) {
+            int64_t borrow = 0;
+
+            for (size_t i = 0; i < size; i++) {
+                int64_t difference = int64_t(words[i]) - (i < other.size ? other.words[i] : 0) - borrow;
+                borrow = difference < 0;
+                words[i] = static_cast<uint32_t>(difference + (borrow << 32));
+            }
+
+            trim();
+        }
+    };
+
+    // The double nearest to a decimal real literal (ties to even) like std::from_chars decodes it,
+    // but in a constant expression: the digits over a power of ten as big integers, divided down
+    // to 64 significant bits and rounded once with the remainder as sticky bit. Literals that
+    // from_chars rejects, rounding to infinity or from nonzero to zero, throw.
+    constexpr double decodeReal(std::string_view text) {
+        // No double needs more significant digits to round right, any further ones only count as sticky
+        constexpr int maxDigits = 800;
+
+        BigNumber numerator;
+        int significant = 0, scale = 0, exponent = 0;
+        bool fraction = false, sticky = false;
+        uint32_t chunk = 0, chunkScale = 1;
+        size_t i = 0;
+
+        for (; i < text.size() && text[i] != 'e' && text[i] != 'E'; i++) {
+            char c = text[i];
+
+            if (c == '_')
+                continue;
+
+            if (c == '.')
+                fraction = true;
+            else if (significant == 0 && c == '0')
+                scale -= fraction;
+            else if (significant == maxDigits) {
+                sticky = sticky || c != '0';
+                scale += !fraction;
+            }
+            else {
+                chunk = chunk * 10 + (c - '0');
+                chunkScale *= 10;
+                significant++;
+                scale -= fraction;
+
+                if (chunkScale == 1000000000) {
+                    numerator.multiplyAdd(chunkScale, chunk);
+                    chunk = 0;
+                    chunkScale = 1;
+                }
+            }
+        }
+
+        numerator.multiplyAdd(chunkScale, chunk);
+
+        if (i < text.size()) {
+            bool negative = ++i < text.size() && text[i] == '-';
+
+            for (i += (i < text.size() && (text[i] == '+' || text[i] == '-')); i < text.size(); i++) {
+                if (text[i] != '_')
+                    exponent = std::min(exponent * 10 + (text[i] - '0'), 100000);
+            }
+
+            exponent = negative ? -exponent : exponent;
+        }
+
+        if (significant == 0)
+            return 0;
+
+        // Decimal exponent of the first significant digit, past these bounds no double is near
+        int magnitude = significant - 1 + scale + exponent;
+
+        if (magnitude > 308 || magnitude < -324)
+            throw std::invalid_argument("Number literal in a Genesis snippet is out of range");
+
+        if (sticky) {
+            numerator.multiplyAdd(10, 1);
+            scale--;
+        }
+
+        BigNumber denominator;
+        denominator.multiplyAdd(1, 1);
+
+        int power = scale + exponent;
+
+        if (power >= 0)
+            numerator.multiplyPowerOfTen(power);
+        else
+            denominator.multiplyPowerOfTen(-power);
+
+        // numerator * 2^shift / denominator lands in [2^62, 2^64)
+        int shift = 63 + static_cast<int>(denominator.bitLength()) - static_cast<int>(numerator.bitLength());
+
+        if (shift >= 0)
+            numerator.shiftLeft(shift);
+        else
+            denominator.shiftLeft(-shift);
+
+        uint64_t quotient = 0;
+        denominator.shiftLeft(63);
+
+        for (int bit = 63; bit >= 0; bit--) {
+            if (numerator.compare(denominator) >= 0) {
+                numerator.subtract(denominator);
+                quotient |= uint64_t(1) << bit;
+            }
+
+            denominator.shiftRightOne();
+        }
+
+        int length = 0;
+
+        for (uint64_t rest = quotient; rest; rest >>= 1)
+            length++;
+
+        // The value lies in [2^binaryExponent, 2^(binaryExponent + 1)), below 2^-1022 with fewer bits
+        int binaryExponent = length - 1 - shift;
+        int bits = binaryExponent >= -1022 ? 53 : binaryExponent + 1075;
+
+        if (bits < 0)
+            throw std::invalid_argument("Number literal in a Genesis snippet is out of range");
+
+        int drop = length - bits;
+        uint64_t mantissa = drop >= 64 ? 0 : quotient >> drop;
+        uint64_t rest = drop >= 64 ? quotient : quotient & ((uint64_t(1) << drop) - 1);
+        uint64_t half = uint64_t(1) << (drop - 1);
+
+        if (rest > half || (rest == half && (numerator.size != 0 || (mantissa & 1))))
+            mantissa++;
+
+        if (mantissa == 0 || binaryExponent + static_cast<int>(mantissa >> bits) > 1023)
+            throw std::invalid_argument("Number literal in a Genesis snippet is out of range");
+
+        // Scaling by powers of two is exact, the mantissa already has the precision of the result
+        double value = static_cast<double>(mantissa);
+        int scaleBy = drop - shift;
+
+        for (; scaleBy >= 64; scaleBy -= 64)
+            value *= 18446744073709551616.0;
+
+        for (; scaleBy <= -64; scaleBy += 64)
+            value /= 18446744073709551616.0;
+
+        for (; scaleBy > 0; scaleBy--)
+            value *= 2;
+
+        for (; scaleBy < 0; scaleBy++)
+            value /= 2;
+
+        return value;
+    }
+
+    // The number literal at `at` in the shape parseNumber() in Lexer accepts, decoded the same way
+    constexpr StaticToken lexNumber(std::string_view source, size_t& at) {
+        size_t start = at;
+        auto peek = [&](size_t offset) { return at + offset < source.size() ? source[at + offset] : '\0'; };
+        bool hex = peek(0) == '0' && (peek(1) == 'x' || peek(1) == 'X');
+        uint64_t base = hex ? 16 : 10;
+
+        uint64_t integer = 0;
+        bool real = false, overflow = false;
+
+        auto isDigit = [&](char c) {
+            return hasCharClass(c, CC_DIGIT) || (hex && static_cast<unsigned char>((c | 0x20) - 'a') < 6);
+        };
+
+        // A run of digits split by single '_' separators, throws when a group is empty
+        auto digitGroups = [&]() {
+            while (true) {
+                size_t group = at;
+
+                for (char c = peek(0); isDigit(c); c = peek(0)) {
+                    uint64_t digit = hasCharClass(c, CC_DIGIT) ? c - '0' : (c | 0x20) - 'a' + 10;
+                    overflow = overflow || integer > (uint64_t(std::numeric_limits<int64_t>::max()) - digit) / base;
+                    integer = integer * base + digit;
+                    at++;
+                }
+
+                if (at == group)
+                    throw std::invalid_argument("Malformed number literal in a Genesis snippet");
+
+                if (peek(0) != '_')
+                    return;
+
+                at++;
+            }
+        };
+
+        if (hex)
+            at += 2;
+
+        digitGroups();
+
+        if (!hex) {
+            // `1.` is a real too, a dot followed by a letter is left for a member access
+            if (peek(0) == '.' && !hasCharClass(peek(1), CC_ALPHA)) {
+                real = true;
+                at++;
+
+                if (hasCharClass(peek(0), CC_DIGIT))
+                    digitGroups();
+            }
+
+            if (peek(0) == 'e' || peek(0) == 'E') {
+                real = true;
+                at++;
+
+                if (peek(0) == '+' || peek(0) == '-')
+                    at++;
+
+                digitGroups();
+            }
+        }
+
+        StaticToken token;
+        token.token = TokenClass::T_NUMBER;
+        token.value = source.substr(start, at - start);
+
+        if (hex && overflow)
+            throw std::invalid_argument("Number literal in a Genesis snippet does not fit in 64 bits");
+
+        // Decimal integers too large for 64 bits are still fine as (rounded) reals
+        if (!real && !overflow) {
+            token.numberKind = NumberKind::INTEGER;
+            token.integer = static_cast<int64_t>(integer);
+        }
+        else {
+            token.numberKind = NumberKind::REAL;
+            token.real = decodeReal(token.value);
+        }
+
+        return token;
+    }
+
+    // Lexes `source` into at most `capacity` tokens, throwing where Lexer reports a problem
+    template <size_t Capacity>
+    constexpr StaticTokens<Capacity> lexInto(std::string_view source) {
+        StaticTokens<Capacity> result;
+        size_t at = 0;
+
+        auto push = [&](StaticToken token) {
+            if (result.count == Capacity)
+                throw std::invalid_argument("Genesis snippet has more tokens than requested");
+
+            result.tokens[result.count++] = token;
+        };
+
+        while (at < source.size()) {
+            char current = source[at];
+            char following = at + 1 < source.size() ? source[at + 1] : '\0';
+            size_t start = at;
+
+            if (hasCharClass(current, CC_SPACE))
+                at++;
+            else if (current == '/' && following == '/') {
+                while (at < source.size() && source[at] != '\n')
+                    at++;
+            }
+            else if (current == '"') {
+                size_t close = source.find('"', at + 1);
+
+                if (close == std::string_view::npos)
+                    throw std::invalid_argument("Unterminated string literal in a Genesis snippet");
+
+                StaticToken token;
+                token.token = TokenClass::T_STRING;
+                token.value = source.substr(at + 1, close - at - 1);
+                push(token);
+                at = close + 1;
+            }
+            else if (OperatorMatch match = matchOperator(current, following); match.length) {
+                StaticToken token;
+                token.token = match.token;
+                token.value = source.substr(start, match.length);
+                push(token);
+                at += match.length;
+            }
+            else if (hasCharClass(current, CC_DIGIT))
+                push(lexNumber(source, at));
+            else if (hasCharClass(current, CC_ALPHA)) {
+                while (at < source.size() && hasCharClass(source[at], CC_IDENTIFIER))
+                    at++;
+
+                StaticToken token;
+                token.value = source.substr(start, at - start);
+                token.token = keywordClass(token.value);
+                push(token);
+            }
+            else
+                throw std::invalid_argument("Unknown character in a Genesis snippet");
+        }
+
+        return result;
+    }
+
+    // Tokens of a string literal, room for one per character unless `MaxTokens` says otherwise
+    template <size_t MaxTokens = 0, size_t Length>
+    constexpr StaticTokens<MaxTokens ? MaxTokens : Length> lex(const char (&source)[Length]) {
+        return lexInto<MaxTokens ? MaxTokens : Length>(std::string_view(source, Length - 1));
+    }
+}
+
+static_assert(genesis::lex("let x = 0x1F <= 2.5e1; // done")[1].token == TokenClass::T_IDENTIFIER
+    && genesis::lex("let x = 0x1F <= 2.5e1;")[3].integer == 31
+    && genesis::lex("let x = 0x1F <= 2.5e1;")[4].token == TokenClass::T_LESSEQUAL
+    && genesis::lex("let x = 0x1F <= 2.5e1;")[5].real == 25.0
+    && genesis::lex("\"a b\" elseif").size() == 2);
+
+#endif // STATIC_LEXER_GENESIS
@@ -1,6 +1,10 @@
+#ifndef TOKEN_CLASS_GENESIS
+#define TOKEN_CLASS_GENESIS
+
 #include "../Util/Source.hpp"
+#include "../Util/Symbols.hpp"
 
-enum class TokenClass {
+enum class TokenClass : uint8_t {
     T_LEFTPAREN,
     T_RIGHTPAREN,
     T_LEFTBRACE,
@@ -53,7 +57,65 @@ enum class TokenClass {
     T_NONE,
 };
 
+// How the value of a number literal was decoded: integers without a fraction or exponent that fit
+// in 64 bits are INTEGER, every other number is REAL
+enum class NumberKind : uint8_t {
+    NONE,
+    INTEGER,
+    REAL,
+};
+
+union NumberBits {
+    int64_t integer;
+    double real;
+};
+
+// `value` views the lexeme inside the SourceBuffer the token was lexed from, it never owns memory.
+// Identifiers and strings lexed with a SymbolInterner also carry their Symbol. Number literals
+// carry the value the lexer decoded, so no later pass converts their text again.
 struct TokenInstance {
     TokenClass token;
-    std::string value;
-};
\ No newline at end of file
+    NumberKind numberKind = NumberKind::NONE;
+    Symbol symbol = noSymbol;
+    std::string_view value;
+    NumberBits numeric { 0 };
+
+    TokenInstance() = default;
+    TokenInstance(TokenClass _token, std::string_view _value, Symbol _symbol = noSymbol) : token(_token), symbol(_symbol), value(_value) {}
+    TokenInstance(std::string_view _value, NumberKind _numberKind, NumberBits _numeric) : token(TokenClass::T_NUMBER), numberKind(_numberKind), value(_value), numeric(_numeric) {}
+
+    static TokenInstance fromInteger(std::string_view text, int64_t integer) {
+        NumberBits bits;
+        bits.integer = integer;
+
+        return TokenInstance(text, NumberKind::INTEGER, bits);
+    }
+
+    static TokenInstance fromReal(std::string_view text, double real) {
+        NumberBits bits;
+        bits.real = real;
+
+        return TokenInstance(text, NumberKind::REAL, bits);
+    }
+
+    // The decoded number as the VM sees it, 0 for tokens that are not number literals
+    double number() const {
+        switch (numberKind) {
+            case NumberKind::INTEGER: return static_cast<double>(numeric.integer);
+            case NumberKind::REAL: return numeric.real;
+            default: return 0;
+        }
+    }
+};
+
+static_assert(sizeof(TokenInstance) == 32, "the kind, number kind and symbol must share the first 8 bytes of a token");
+
+// Interned lexemes compare by symbol, the text is only looked at when one side was not interned
+inline bool sameLexeme(const TokenInstance& a, const TokenInstance& b) {
+    if (a.symbol != noSymbol && b.symbol != noSymbol)
+        return a.symbol == b.symbol;
+
+    return a.value == b.value;
+}
+
+#endif // TOKEN_CLASS_GENESIS
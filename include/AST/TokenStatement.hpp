@@ -1,4 +1,9 @@
+#ifndef TOKEN_STATEMENT_GENESIS
+#define TOKEN_STATEMENT_GENESIS
+
 #include "Lexer.hpp"
+#include "../Util/Arena.hpp"
+#include "../Util/OutputBuffer.hpp"
 
 class Expression;
 class Statement;
@@ -7,6 +12,10 @@ class LiteralValue;
 class Binary;
 class Unary;
 class Grouping;
+class Let;
+
+// Text of a whole tree, built without recursion (see TreePrinter below)
+inline std::string treeString(Statement* root);
 
 class Visit {
 public:
@@ -15,79 +24,303 @@ public:
     virtual void visit(Binary&) = 0;
     virtual void visit(Unary&) = 0;
     virtual void visit(Grouping&) = 0;
+    virtual void visit(Let&) = 0;
 };
 
+// Concrete type of a node, for passes that dispatch with a switch (see dispatch() below) instead
+// of a virtual accept()
+enum class NodeKind : uint8_t {
+    LITERAL,
+    BINARY,
+    UNARY,
+    GROUPING,
+    LET,
+};
+
+// Nodes are allocated from the Arena of their compilation unit and must stay trivially
+// destructible, child pointers are non-owning.
 class Statement {
 public:
+    const NodeKind kind;
+
+    Statement(NodeKind _kind) : kind(_kind) {}
+
     virtual void accept(Visit &) = 0;
     virtual std::string toString() = 0;
 };
 
 class Expression : public Statement {
 public:
+    Expression(NodeKind _kind) : Statement(_kind) {}
+
     virtual void accept(Visit &) = 0;
     virtual std::string toString() = 0;
 };
 
 class LiteralValue : public Expression {
 public:
+    static constexpr NodeKind nodeKind = NodeKind::LITERAL;
+
     TokenInstance token;
 
-    LiteralValue(TokenInstance _token) : token(_token) {};
+    LiteralValue(TokenInstance _token) : Expression(nodeKind), token(_token) {};
 
     void accept(Visit &visitor) {
         visitor.visit(*this);
     };
 
     std::string toString() {
-        return token.value;
+        return treeString(this);
     }
 };
 
 class Binary : public Expression {
 public:
-    std::shared_ptr<Statement> left;
-    std::shared_ptr<Statement> right;
+    static constexpr NodeKind nodeKind = NodeKind::BINARY;
+
+    Statement* left;
+    Statement* right;
     TokenInstance op;
 
-    Binary(std::shared_ptr<Statement> _left, std::shared_ptr<Statement> _right, TokenInstance _op) : left(_left), right(_right), op(_op) {};
+    Binary(Statement* _left, Statement* _right, TokenInstance _op) : Expression(nodeKind), left(_left), right(_right), op(_op) {};
 
     void accept(Visit &visitor) {
         visitor.visit(*this);
     };
 
     std::string toString() {
-        return format("(%s %s %s)", { left->toString(), op.value, right->toString() });
+        return treeString(this);
     }
 };
 
 class Unary : public Expression {
 public:
-    std::shared_ptr<Statement> right;
+    static constexpr NodeKind nodeKind = NodeKind::UNARY;
+
+    Statement* right;
     TokenInstance op;
 
-    Unary(std::shared_ptr<Statement> _right, TokenInstance _op) : right(_right), op(_op) {};
+    Unary(Statement* _right, TokenInstance _op) : Expression(nodeKind), right(_right), op(_op) {};
     
     void accept(Visit &visitor) {
         visitor.visit(*this);
     };
 
     std::string toString() {
-        return format("(%s %s)", { op.value, right->toString() });
+        return treeString(this);
     }
 };
 
 class Grouping : public Expression {
 public:
-    std::shared_ptr<Statement> expression;
+    static constexpr NodeKind nodeKind = NodeKind::GROUPING;
+
+    Statement* expression;
 
-    Grouping(std::shared_ptr<Statement> _expression) : expression(_expression) {};
+    Grouping(Statement* _expression) : Expression(nodeKind), expression(_expression) {};
     
     void accept(Visit &visitor) {
         visitor.visit(*this);
     };
 
     std::string toString() {
-        return format("(%s)", { expression->toString() });
+        return treeString(this);
     }
-};
\ No newline at end of file
+};
+
+class Let : public Statement {
+public:
+    static constexpr NodeKind nodeKind = NodeKind::LET;
+
+    TokenInstance name;
+    Statement* initializer;
+
+    Let(TokenInstance _name, Statement* _initializer) : Statement(nodeKind), name(_name), initializer(_initializer) {};
+
+    void accept(Visit &visitor) {
+        visitor.visit(*this);
+    };
+
+    std::string toString() {
+        return treeString(this);
+    }
+};
+
+static_assert(std::is_trivially_destructible_v<LiteralValue> && std::is_trivially_destructible_v<Binary>
+    && std::is_trivially_destructible_v<Unary> && std::is_trivially_destructible_v<Grouping> && std::is_trivially_destructible_v<Let>,
+    "AST nodes are released together with their Arena and must not need a destructor");
+
+// Calls `visitor` with `node` cast to its concrete type. A switch on the kind tag instead of two
+// virtual calls, so the compiler can inline the visitor into the loop that walks the tree. Every
+// overload (or a generic lambda) has to return the same type.
+template <typename Visitor>
+inline decltype(auto) dispatch(Statement* node, Visitor&& visitor) {
+    switch (node->kind) {
+        case NodeKind::LITERAL: return visitor(static_cast<LiteralValue&>(*node));
+        case NodeKind::BINARY: return visitor(static_cast<Binary&>(*node));
+        case NodeKind::UNARY: return visitor(static_cast<Unary&>(*node));
+        case NodeKind::GROUPING: return visitor(static_cast<Grouping&>(*node));
+        case NodeKind::LET: break;
+    }
+
+    return visitor(static_cast<Let&>(*node));
+}
+
+// Checked downcast by kind tag, nullptr when `node` is not a T (or is nullptr)
+template <typename T>
+inline T* nodeCast(Statement* node) {
+    return node && node->kind == T::nodeKind ? static_cast<T*>(node) : nullptr;
+}
+
+// Static counterpart of Visit. Derived classes implement the same visit() overloads and call
+// apply(), which dispatches on the kind tag without virtual calls. A visitor migrates gradually by
+// deriving from both Visit and StaticVisit<Self> and being declared final: node->accept() keeps
+// working while the hot loops switch to apply(), where the calls can be inlined.
+template <typename Derived, typename Result = void>
+class StaticVisit {
+public:
+    Result apply(Statement* node) {
+        return dispatch(node, [this](auto& concrete) -> Result { return static_cast<Derived*>(this)->visit(concrete); });
+    }
+};
+
+enum class TreeFormat {
+    SEXPR,      // nested parentheses, e.g. (let x ((- (y)) + 1))
+    COMPACT,    // prefix form for tools, see TreePrinter
+};
+
+// Streams trees into an OutputBuffer. Expanding a node appends what comes before its first child
+// and pushes the rest, text pieces and children, in reverse onto an explicit stack, so any depth
+// prints in linear time. Keep one printer around to reuse its stack for every statement.
+//
+// The compact format writes every node in prefix order as one kind letter, followed by its lexeme
+// as <length>:<bytes> where it has one: N number, S string (without quotes), I identifier, T true,
+// F false, Z null, B binary operator, U unary operator, G grouping, L let (with the name). e.g.
+// `let x = -(y) + 1;` is L1:xB1:+U1:-GI1:yN1:1
+class TreePrinter final : public Visit, public StaticVisit<TreePrinter> {
+private:
+    struct Piece {
+        Statement* node;
+        std::string_view text;
+    };
+
+    std::vector<Piece> stack;
+    OutputBuffer* out = nullptr;
+    TreeFormat format = TreeFormat::SEXPR;
+
+    void push(std::string_view text) {
+        stack.push_back(Piece { nullptr, text });
+    }
+
+    void push(Statement* node) {
+        stack.push_back(Piece { node, std::string_view() });
+    }
+
+    void lexeme(char kind, std::string_view text) {
+        out->append(kind);
+        out->appendNumber(text.size());
+        out->append(':');
+        out->append(text);
+    }
+
+public:
+    void visit(Expression&) {}
+
+    void visit(LiteralValue& node) {
+        if (format == TreeFormat::SEXPR) {
+            out->append(node.token.value);
+            return;
+        }
+
+        switch (node.token.token) {
+            case TokenClass::T_NUMBER: lexeme('N', node.token.value); break;
+            case TokenClass::T_STRING: lexeme('S', node.token.value); break;
+            case TokenClass::T_TRUE: out->append('T'); break;
+            case TokenClass::T_FALSE: out->append('F'); break;
+            case TokenClass::T_NULL: out->append('Z'); break;
+            default: lexeme('I', node.token.value); break;
+        }
+    }
+
+    void visit(Binary& node) {
+        if (format == TreeFormat::COMPACT) {
+            lexeme('B', node.op.value);
+            push(node.right);
+            push(node.left);
+            return;
+        }
+
+        push(")");
+        push(node.right);
+        push(" ");
+        push(node.op.value);
+        push(" ");
+        push(node.left);
+        out->append('(');
+    }
+
+    void visit(Unary& node) {
+        if (format == TreeFormat::COMPACT) {
+            lexeme('U', node.op.value);
+            push(node.right);
+            return;
+        }
+
+        push(")");
+        push(node.right);
+        push(" ");
+        push(node.op.value);
+        out->append('(');
+    }
+
+    void visit(Grouping& node) {
+        if (format == TreeFormat::COMPACT) {
+            out->append('G');
+            push(node.expression);
+            return;
+        }
+
+        push(")");
+        push(node.expression);
+        out->append('(');
+    }
+
+    void visit(Let& node) {
+        if (format == TreeFormat::COMPACT) {
+            lexeme('L', node.name.value);
+            push(node.initializer);
+            return;
+        }
+
+        push(")");
+        push(node.initializer);
+        push(" ");
+        push(node.name.value);
+        out->append("(let ");
+    }
+
+    void print(Statement* root, OutputBuffer& output, TreeFormat _format = TreeFormat::SEXPR) {
+        out = &output;
+        format = _format;
+        push(root);
+
+        while (!stack.empty()) {
+            Piece piece = stack.back();
+            stack.pop_back();
+
+            if (piece.node)
+                apply(piece.node);
+            else
+                out->append(piece.text);
+        }
+    }
+};
+
+inline std::string treeString(Statement* root) {
+    OutputBuffer output;
+    TreePrinter().print(root, output);
+
+    return output.take();
+}
+
+#endif // TOKEN_STATEMENT_GENESIS
@@ -0,0 +1,151 @@
+#ifndef TOKEN_STORE_GENESIS
+#define TOKEN_STORE_GENESIS
+
+#include "./TokenStream.hpp"
+#include <cstdint>
+
+// Compact token storage for large inputs: a 1-byte kind, a 32-bit offset into the source and a
+// 32-bit length in three parallel arrays, 9 bytes per token instead of a 32-byte TokenInstance.
+// Lexemes are rebuilt from the source on access, so the source has to outlive the store. Stores
+// of interned tokens keep a fourth array with the symbols, decoded numbers are kept on the side
+// together with the index of their token.
+class TokenStore {
+private:
+    struct StoredNumber {
+        uint32_t index;
+        NumberKind kind;
+        NumberBits bits;
+    };
+
+    std::string_view source;
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<Symbol> symbols;
+    std::vector<StoredNumber> numbers;
+    bool interned = false;
+
+public:
+    // Offsets are 32-bit, the Lexer refuses sources above this size for the store
+    static constexpr size_t maxSourceSize = UINT32_MAX;
+
+    TokenStore(std::string_view _source = std::string_view(), bool _interned = false) : source(_source), interned(_interned) {}
+
+    void reserve(size_t count) {
+        kinds.reserve(count);
+        offsets.reserve(count);
+        lengths.reserve(count);
+
+        if (interned)
+            symbols.reserve(count);
+    }
+
+    // `token` has to view the store's source
+    void push(const TokenInstance& token) {
+        kinds.push_back(static_cast<uint8_t>(token.token));
+        offsets.push_back(static_cast<uint32_t>(token.value.data() - source.data()));
+        lengths.push_back(static_cast<uint32_t>(token.value.size()));
+
+        if (interned)
+            symbols.push_back(token.symbol);
+
+        if (token.numberKind != NumberKind::NONE)
+            numbers.push_back(StoredNumber { static_cast<uint32_t>(kinds.size() - 1), token.numberKind, token.numeric });
+    }
+
+    // Adds the tokens of `other`, which has to view the same source, after the ones held
+    void append(const TokenStore& other) {
+        size_t base = kinds.size();
+
+        kinds.insert(kinds.end(), other.kinds.begin(), other.kinds.end());
+        offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+        lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+
+        if (interned)
+            symbols.insert(symbols.end(), other.symbols.begin(), other.symbols.end());
+
+        for (StoredNumber number : other.numbers) {
+            number.index += static_cast<uint32_t>(base);
+            numbers.push_back(number);
+        }
+    }
+
+    size_t size() const {
+        return kinds.size();
+    }
+
+    TokenClass kind(size_t index) const {
+        return static_cast<TokenClass>(kinds[index]);
+    }
+
+    uint32_t offset(size_t index) const {
+        return offsets[index];
+    }
+
+    uint32_t length(size_t index) const {
+        return lengths[index];
+    }
+
+    Symbol symbol(size_t index) const {
+        return interned ? symbols[index] : noSymbol;
+    }
+
+    std::string_view lexeme(size_t index) const {
+        return source.substr(offsets[index], lengths[index]);
+    }
+
+    // Position in the side array of the first number at or after token `index`
+    size_t numberFrom(size_t index) const {
+        return std::lower_bound(numbers.begin(), numbers.end(), index, [](const StoredNumber& number, size_t at) { return number.index < at; }) - numbers.begin();
+    }
+
+    // Token `index`, whose decoded number is looked up from `number` on (see numberFrom)
+    TokenInstance at(size_t index, size_t& number) const {
+        std::string_view text(source.data() + offsets[index], lengths[index]);
+
+        if (number < numbers.size() && numbers[number].index == index) {
+            const StoredNumber& stored = numbers[number++];
+            return TokenInstance { text, stored.kind, stored.bits };
+        }
+
+        return TokenInstance { kind(index), text, symbol(index) };
+    }
+
+    TokenInstance operator[](size_t index) const {
+        size_t number = numberFrom(index);
+        return at(index, number);
+    }
+
+    std::string_view text() const {
+        return source;
+    }
+
+    // Memory held by the arrays
+    size_t bytes() const {
+        return kinds.capacity() * sizeof(uint8_t) + offsets.capacity() * sizeof(uint32_t) + lengths.capacity() * sizeof(uint32_t) + symbols.capacity() * sizeof(Symbol)
+            + numbers.capacity() * sizeof(StoredNumber);
+    }
+};
+
+// Feeds a TokenStore to a TokenStream, and so to the Parser, a ring buffer's worth at a time
+class TokenStoreReader : public TokenSource {
+private:
+    const TokenStore& store;
+    size_t current = 0;
+    size_t number = 0;
+
+public:
+    TokenStoreReader(const TokenStore& _store) : store(_store) {}
+
+    size_t fill(TokenInstance* out, size_t max) override {
+        size_t count = std::min(max, store.size() - current);
+
+        for (size_t i = current; i < current + count; i++)
+            *out++ = store.at(i, number);
+
+        current += count;
+        return count;
+    }
+};
+
+#endif // TOKEN_STORE_GENESIS
@@ -0,0 +1,105 @@
+#ifndef TOKEN_STREAM_GENESIS
+#define TOKEN_STREAM_GENESIS
+
+#include "./TokenClass.hpp"
+#include <array>
+
+// Anything that can hand out tokens in batches, the Lexer being the main one
+class TokenSource {
+public:
+    virtual ~TokenSource() = default;
+
+    // Writes up to `max` tokens to `out` and returns how many were written, 0 once the source is exhausted
+    virtual size_t fill(TokenInstance* out, size_t max) = 0;
+};
+
+// Pull-based view over a token sequence with a bounded lookahead. Backed either by a TokenSource,
+// in which case only a small ring of tokens is ever held, or by an existing vector (no copies).
+class TokenStream {
+public:
+    static constexpr size_t capacity = 256;
+
+private:
+    std::array<TokenInstance, capacity> ring;
+    size_t head = 0, tail = 0;   // running counts, masked on access
+    size_t overruns = 0;         // next() calls made at the end of the input
+
+    TokenSource* source = nullptr;
+    bool exhausted = false;
+
+    const TokenInstance* direct = nullptr;
+    size_t directCount = 0;
+
+    TokenInstance previous { TokenClass::T_NONE, std::string_view() };
+    const TokenInstance endToken { TokenClass::T_NONE, std::string_view() };
+
+    // Makes sure at least `count` tokens are buffered, unless the source runs dry first
+    void require(size_t count) {
+        while (tail - head < count && !exhausted) {
+            size_t offset = tail & (capacity - 1);
+            size_t space = std::min(capacity - (tail - head), capacity - offset);
+            size_t written = source->fill(&ring[offset], space);
+
+            if (written == 0)
+                exhausted = true;
+
+            tail += written;
+        }
+    }
+
+public:
+    TokenStream(TokenSource& _source) : source(&_source) {}
+
+    // The vector is referenced, not copied, and has to outlive the stream
+    TokenStream(const std::vector<TokenInstance>& tokens) : exhausted(true), direct(tokens.data()), directCount(tokens.size()) {}
+
+    // Token `k` positions ahead of the next one, a T_NONE token past the end. `k` must stay below capacity.
+    const TokenInstance& peek(size_t k = 0) {
+        if (direct)
+            return (head + k < directCount) ? direct[head + k] : endToken;
+
+        if (tail - head <= k)
+            require(k + 1);
+
+        return (tail - head > k) ? ring[(head + k) & (capacity - 1)] : endToken;
+    }
+
+    // Returns the consumed token, which stays valid until the next call
+    const TokenInstance& next() {
+        previous = peek();
+
+        if (!atEnd())
+            head++;
+        else
+            overruns++;
+
+        return previous;
+    }
+
+    // The last token returned by next()
+    const TokenInstance& last() const {
+        return previous;
+    }
+
+    bool atEnd() {
+        if (direct)
+            return head >= directCount;
+
+        if (head == tail)
+            require(1);
+
+        return head == tail;
+    }
+
+    // Number of tokens consumed so far
+    size_t position() const {
+        return head;
+    }
+
+    // Whether something tried to consume past the last token, i.e. the input ended mid-construct
+    bool overran() const {
+        return overruns > 0;
+    }
+};
+
+#endif // TOKEN_STREAM_GENESIS
@@ -0,0 +1,62 @@
+#ifndef TRAVERSAL_GENESIS
+#define TRAVERSAL_GENESIS
+
+#include "TokenStatement.hpp"
+
+// The fields holding the children of a node, left to right. They are writable, so a pass can put
+// a replacement node in place of a child.
+class ChildSlots : public StaticVisit<ChildSlots> {
+public:
+    Statement** slots[2] = {};
+    uint8_t count = 0;
+
+    void visit(LiteralValue&) { count = 0; }
+    void visit(Binary& node) { slots[0] = &node.left; slots[1] = &node.right; count = 2; }
+    void visit(Unary& node) { slots[0] = &node.right; count = 1; }
+    void visit(Grouping& node) { slots[0] = &node.expression; count = 1; }
+    void visit(Let& node) { slots[0] = &node.initializer; count = 1; }
+};
+
+// Walks trees children first on a stack kept on the heap, so a tree nested a million levels deep
+// costs a million small frames of memory instead of overflowing the call stack. The stack is kept
+// between walks, a long-lived TreeWalk stops allocating once it has seen its deepest tree.
+class TreeWalk {
+private:
+    struct Frame {
+        Statement** slot;
+        Statement** children[2];
+        uint8_t count, next;
+    };
+
+    std::vector<Frame> stack;
+    ChildSlots children;
+
+    void push(Statement** slot) {
+        children.apply(*slot);
+        stack.push_back(Frame { slot, { children.slots[0], children.slots[1] }, children.count, 0 });
+    }
+
+public:
+    // Calls `leave(node)` for every node of the tree in `root` after all of its children. `node`
+    // is the field (or `root`) pointing at the node, assigning to it replaces the node in the tree.
+    template <typename Leave>
+    void postOrder(Statement*& root, Leave&& leave) {
+        stack.clear();
+        push(&root);
+
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+
+            if (frame.next < frame.count) {
+                push(frame.children[frame.next++]);
+                continue;
+            }
+
+            Statement** slot = frame.slot;
+            stack.pop_back();
+            leave(*slot);
+        }
+    }
+};
+
+#endif // TRAVERSAL_GENESIS
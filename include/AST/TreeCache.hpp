@@ -0,0 +1,688 @@
+#ifndef TREE_CACHE_GENESIS
+#define TREE_CACHE_GENESIS
+
+#include "./Traversal.hpp"
+#include "./TokenStore.hpp"
+#include "../Util/Hash.hpp"
+#include "../Util/SourceBuffer.hpp"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <random>
+
+// Binary image of one lexed and parsed input, laid out so it can be mapped and read in place:
+//
+//   CacheHeader
+//   uint8_t    token kinds[tokenCount]       (padded to 4 bytes)
+//   uint32_t   token offsets[tokenCount]     (into the source)
+//   uint32_t   token lengths[tokenCount]
+//   NodeRecord nodes[nodeCount]              (post-order, children before their parent)
+//   uint32_t   statements[statementCount]    (root node of every top-level statement)
+//
+// Lexemes are not copied, tokens and nodes point back into the source the image was made from.
+// Everything is stored in host byte order, an image written on another byte order is rejected.
+constexpr uint32_t treeCacheVersion = 2;
+constexpr uint32_t treeCacheByteOrder = 0x01020304;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t key;
+    uint64_t sourceSize;
+    uint32_t tokenCount;
+    uint32_t nodeCount;
+    uint32_t statementCount;
+    uint32_t reserved;
+    uint64_t checksum;    // hashBytes of everything after the header, for tools, hits do not hash
+};
+
+enum class CachedNodeKind : uint8_t {
+    LITERAL,    // token, number literals keep their NumberKind in reserved and the value in first and second
+    BINARY,     // token = operator, first = left, second = right
+    UNARY,      // token = operator, first = operand
+    GROUPING,   // first = expression
+    LET,        // token = name, first = initializer
+};
+
+struct NodeRecord {
+    CachedNodeKind kind;
+    uint8_t tokenKind;
+    uint16_t reserved;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t first;
+    uint32_t second;
+};
+
+static_assert(sizeof(CacheHeader) == 56 && sizeof(NodeRecord) == 20, "the cache layout must not depend on the compiler");
+
+constexpr char treeCacheMagic[8] = { 'G', 'E', 'N', 'E', 'S', 'I', 'S', 'T' };
+
+// Hash of the source bytes seeded with the compiler and format version, names the cache entry
+inline uint64_t treeCacheKey(std::string_view source) {
+    static const uint64_t versionSeed = hashBytes(GENESIS_VERSION, treeCacheVersion);
+    return hashBytes(source, versionSeed);
+}
+
+// Flattens a statement list into NodeRecords, children first. The walk visits every node after
+// its children, whose record indices are waiting on top of `written` by then.
+class TreeWriter final : public Visit, public StaticVisit<TreeWriter> {
+private:
+    std::string_view source;
+    std::vector<NodeRecord>& nodes;
+    std::vector<uint32_t> written;
+    TreeWalk walk;
+
+    uint32_t take() {
+        uint32_t index = written.back();
+        written.pop_back();
+
+        return index;
+    }
+
+    void push(CachedNodeKind kind, const TokenInstance* token, uint32_t first, uint32_t second) {
+        NodeRecord record {};
+        record.kind = kind;
+        record.first = first;
+        record.second = second;
+
+        if (token) {
+            record.tokenKind = static_cast<uint8_t>(token->token);
+            record.offset = static_cast<uint32_t>(token->value.data() - source.data());
+            record.length = static_cast<uint32_t>(token->value.size());
+        }
+
+        if (kind == CachedNodeKind::LITERAL && token->numberKind != NumberKind::NONE) {
+            uint64_t bits;
+            std::memcpy(&bits, &token->numeric, sizeof(bits));
+
+            record.reserved = static_cast<uint16_t>(token->numberKind);
+            record.first = static_cast<uint32_t>(bits);
+            record.second = static_cast<uint32_t>(bits >> 32);
+        }
+
+        nodes.push_back(record);
+        written.push_back(static_cast<uint32_t>(nodes.size() - 1));
+    }
+
+public:
+    TreeWriter(std::string_view _source, std::vector<NodeRecord>& _nodes) : source(_source), nodes(_nodes) {}
+
+    void visit(Expression&) {}
+
+    void visit(LiteralValue& node) {
+        push(CachedNodeKind::LITERAL, &node.token, 0, 0);
+    }
+
+    void visit(Binary& node) {
+        uint32_t right = take();
+        uint32_t left = take();
+        push(CachedNodeKind::BINARY, &node.op, left, right);
+    }
+
+    void visit(Unary& node) {
+        push(CachedNodeKind::UNARY, &node.op, take(), 0);
+    }
+
+    void visit(Grouping&) {
+        push(CachedNodeKind::GROUPING, nullptr, take(), 0);
+    }
+
+    void visit(Let& node) {
+        push(CachedNodeKind::LET, &node.name, take(), 0);
+    }
+
+    uint32_t root(Statement* statement) {
+        walk.postOrder(statement, [&](Statement*& node) { apply(node); });
+        return take();
+    }
+};
+
+// The image for `source`, whose tokens and freshly parsed (not yet optimized) statements are given
+inline std::string serializeTree(std::string_view source, uint64_t key, const TokenStore& tokens, const std::vector<Statement*>& statements) {
+    std::vector<NodeRecord> nodes;
+    std::vector<uint32_t> roots;
+    TreeWriter writer(source, nodes);
+
+    for (auto statement : statements)
+        roots.push_back(writer.root(statement));
+
+    CacheHeader header {};
+    std::memcpy(header.magic, treeCacheMagic, sizeof(header.magic));
+    header.version = treeCacheVersion;
+    header.byteOrder = treeCacheByteOrder;
+    header.key = key;
+    header.sourceSize = source.size();
+    header.tokenCount = static_cast<uint32_t>(tokens.size());
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.statementCount = static_cast<uint32_t>(roots.size());
+
+    std::string image;
+    auto append = [&](const void* data, size_t size) { image.append(static_cast<const char*>(data), size); };
+
+    append(&header, sizeof(header));
+
+    for (size_t i = 0; i < tokens.size(); i++)
+        image += static_cast<char>(tokens.kind(i));
+
+    image.append((4 - tokens.size() % 4) % 4, '\0');
+
+    for (size_t i = 0; i < tokens.size(); i++) {
+        uint32_t offset = tokens.offset(i);
+        append(&offset, sizeof(offset));
+    }
+
+    for (size_t i = 0; i < tokens.size(); i++) {
+        uint32_t length = tokens.length(i);
+        append(&length, sizeof(length));
+    }
+
+    append(nodes.data(), nodes.size() * sizeof(NodeRecord));
+    append(roots.data(), roots.size() * sizeof(uint32_t));
+
+    header.checksum = hashBytes(std::string_view(image).substr(sizeof(header)));
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    return image;
+}
+
+// Read-only view of a cache image, usually straight over the mapped file. open() only checks the
+// header and that the sections add up to the image size, so a hit costs nothing per node before
+// its records are used. Records are checked as they are read instead (checkedToken(),
+// checkedNode() and the consumers built on them): a damaged image is reported by the consumer
+// that reads the damage and the caller falls back to parsing. A corruption that still reads as a
+// well-formed tree is not detected, --verify-cache compares hits against a fresh parse for that.
+class CachedTree {
+private:
+    std::string_view image;
+    std::string_view source;
+    CacheHeader header {};
+    size_t offsetsAt = 0, lengthsAt = 0, nodesAt = 0, statementsAt = 0;
+
+    template <typename T>
+    T read(size_t at) const {
+        T value;
+        std::memcpy(&value, image.data() + at, sizeof(T));
+        return value;
+    }
+
+    bool inSource(uint32_t offset, uint32_t length) const {
+        return static_cast<uint64_t>(offset) + length <= source.size();
+    }
+
+public:
+    // `image` and `source` have to outlive the view and every statement materialized from it
+    bool open(std::string_view _image, std::string_view _source) {
+        image = _image;
+        source = _source;
+
+        if (image.size() < sizeof(CacheHeader))
+            return false;
+
+        header = read<CacheHeader>(0);
+
+        if (std::memcmp(header.magic, treeCacheMagic, sizeof(header.magic)) != 0 || header.version != treeCacheVersion
+            || header.byteOrder != treeCacheByteOrder || header.sourceSize != source.size())
+            return false;
+
+        uint64_t tokens = header.tokenCount;
+        offsetsAt = sizeof(CacheHeader) + (tokens + 3) / 4 * 4;
+        lengthsAt = offsetsAt + tokens * 4;
+        nodesAt = lengthsAt + tokens * 4;
+        statementsAt = nodesAt + static_cast<uint64_t>(header.nodeCount) * sizeof(NodeRecord);
+
+        return statementsAt + static_cast<uint64_t>(header.statementCount) * 4 == image.size();
+    }
+
+    uint64_t key() const {
+        return header.key;
+    }
+
+    size_t tokenCount() const {
+        return header.tokenCount;
+    }
+
+    TokenClass tokenKind(size_t index) const {
+        return static_cast<TokenClass>(image[sizeof(CacheHeader) + index]);
+    }
+
+    uint32_t tokenOffset(size_t index) const {
+        return read<uint32_t>(offsetsAt + index * 4);
+    }
+
+    uint32_t tokenLength(size_t index) const {
+        return read<uint32_t>(lengthsAt + index * 4);
+    }
+
+    // Token `index` with only kind and lexeme (decoded numbers are kept in the node records),
+    // false if its kind or range cannot be right
+    bool checkedToken(size_t index, TokenInstance& token) const {
+        if (static_cast<uint8_t>(tokenKind(index)) > static_cast<uint8_t>(TokenClass::T_NONE) || !inSource(tokenOffset(index), tokenLength(index)))
+            return false;
+
+        token = TokenInstance { tokenKind(index), source.substr(tokenOffset(index), tokenLength(index)) };
+        return true;
+    }
+
+    size_t nodeCount() const {
+        return header.nodeCount;
+    }
+
+    NodeRecord node(size_t index) const {
+        return read<NodeRecord>(nodesAt + index * sizeof(NodeRecord));
+    }
+
+    // Record `index`, false if it cannot have been written by serializeTree(). Children are only
+    // checked to come before their parent, which is all any reader needs to stay in bounds.
+    bool checkedNode(size_t index, NodeRecord& record) const {
+        if (index >= header.nodeCount)
+            return false;
+
+        record = node(index);
+        bool unary = record.kind == CachedNodeKind::UNARY || record.kind == CachedNodeKind::GROUPING || record.kind == CachedNodeKind::LET;
+
+        if (record.kind > CachedNodeKind::LET || record.tokenKind > static_cast<uint8_t>(TokenClass::T_NONE) || !inSource(record.offset, record.length))
+            return false;
+
+        if (record.reserved > static_cast<uint16_t>(NumberKind::REAL) || (record.reserved && (record.kind != CachedNodeKind::LITERAL || record.tokenKind != static_cast<uint8_t>(TokenClass::T_NUMBER))))
+            return false;
+
+        // Post-order, so a valid child always comes first
+        return !((record.kind == CachedNodeKind::BINARY && (record.first >= index || record.second >= index)) || (unary && record.first >= index));
+    }
+
+    TokenInstance nodeToken(const NodeRecord& record) const {
+        std::string_view text = source.substr(record.offset, record.length);
+
+        if (record.reserved != static_cast<uint16_t>(NumberKind::NONE)) {
+            uint64_t bits = record.first | static_cast<uint64_t>(record.second) << 32;
+            NumberBits numeric;
+            std::memcpy(&numeric, &bits, sizeof(bits));
+
+            return TokenInstance { text, static_cast<NumberKind>(record.reserved), numeric };
+        }
+
+        return TokenInstance { static_cast<TokenClass>(record.tokenKind), text };
+    }
+
+    size_t statementCount() const {
+        return header.statementCount;
+    }
+
+    uint32_t statement(size_t index) const {
+        return read<uint32_t>(statementsAt + index * 4);
+    }
+
+    // Rebuilds the Statement tree in `arena` with one forward pass over the nodes, for consumers
+    // that rewrite the tree. Every statement's nodes follow the ones of the statement before, so
+    // the operands of a node are always the last ones built. Symbols are not part of the image,
+    // with `symbols` names and strings are interned again on the way. False on a damaged image.
+    bool materialize(Arena& arena, std::vector<Statement*>& statements, SymbolInterner* symbols = nullptr) const {
+        struct Built {
+            uint32_t index;
+            Statement* node;
+        };
+
+        std::vector<Built> operands;
+        SymbolCache cache(symbols);
+        NodeRecord record;
+        size_t next = 0;
+
+        auto named = [&](TokenInstance token) {
+            if (token.token == TokenClass::T_IDENTIFIER || token.token == TokenClass::T_STRING)
+                token.symbol = cache.intern(token.value);
+
+            return token;
+        };
+
+        // The operand `index` has to be on top, where the post-order walk left it
+        auto take = [&](uint32_t index, Statement*& node) {
+            if (operands.empty() || operands.back().index != index)
+                return false;
+
+            node = operands.back().node;
+            operands.pop_back();
+
+            return true;
+        };
+
+        statements.assign(header.statementCount, nullptr);
+
+        for (size_t i = 0; i < statements.size(); i++) {
+            uint32_t root = statement(i);
+
+            for (; next <= root; next++) {
+                Statement* first = nullptr;
+                Statement* second = nullptr;
+
+                if (!checkedNode(next, record))
+                    return false;
+
+                switch (record.kind) {
+                    case CachedNodeKind::LITERAL:
+                        operands.push_back(Built { static_cast<uint32_t>(next), arena.make<LiteralValue>(named(nodeToken(record))) });
+                        break;
+                    case CachedNodeKind::BINARY:
+                        if (!take(record.second, second) || !take(record.first, first))
+                            return false;
+
+                        operands.push_back(Built { static_cast<uint32_t>(next), arena.make<Binary>(first, second, nodeToken(record)) });
+                        break;
+                    case CachedNodeKind::UNARY:
+                        if (!take(record.first, first))
+                            return false;
+
+                        operands.push_back(Built { static_cast<uint32_t>(next), arena.make<Unary>(first, nodeToken(record)) });
+                        break;
+                    case CachedNodeKind::GROUPING:
+                        if (!take(record.first, first))
+                            return false;
+
+                        operands.push_back(Built { static_cast<uint32_t>(next), arena.make<Grouping>(first) });
+                        break;
+                    case CachedNodeKind::LET:
+                        if (!take(record.first, first))
+                            return false;
+
+                        operands.push_back(Built { static_cast<uint32_t>(next), arena.make<Let>(named(nodeToken(record)), first) });
+                        break;
+                }
+            }
+
+            if (operands.size() != 1 || !take(root, statements[i]))
+                return false;
+        }
+
+        return next == header.nodeCount;
+    }
+};
+
+// Prints the statements of a cache image straight from its records, with the same output as
+// TreePrinter gives for the materialized tree. Like TreePrinter it expands nodes from an explicit
+// stack. A statement may not expand more nodes than it has records, which keeps a damaged image
+// whose children are shared or out of the statement from printing forever.
+class CachedTreePrinter {
+private:
+    struct Piece {
+        uint32_t node;
+        bool isNode;
+        std::string_view text;
+    };
+
+    std::vector<Piece> stack;
+    OutputBuffer* out = nullptr;
+
+    void push(std::string_view text) {
+        stack.push_back(Piece { 0, false, text });
+    }
+
+    void push(uint32_t node) {
+        stack.push_back(Piece { node, true, std::string_view() });
+    }
+
+    void lexeme(char kind, std::string_view text) {
+        out->append(kind);
+        out->appendNumber(text.size());
+        out->append(':');
+        out->append(text);
+    }
+
+    void literal(const TokenInstance& token, TreeFormat format) {
+        if (format == TreeFormat::SEXPR) {
+            out->append(token.value);
+            return;
+        }
+
+        switch (token.token) {
+            case TokenClass::T_NUMBER: lexeme('N', token.value); break;
+            case TokenClass::T_STRING: lexeme('S', token.value); break;
+            case TokenClass::T_TRUE: out->append('T'); break;
+            case TokenClass::T_FALSE: out->append('F'); break;
+            case TokenClass::T_NULL: out->append('Z'); break;
+            default: lexeme('I', token.value); break;
+        }
+    }
+
+    void expand(const NodeRecord& record, std::string_view text, TreeFormat format) {
+        bool compact = format == TreeFormat::COMPACT;
+
+        switch (record.kind) {
+            case CachedNodeKind::LITERAL:
+                break;
+            case CachedNodeKind::BINARY:
+                if (compact) {
+                    lexeme('B', text);
+                    push(record.second);
+                    push(record.first);
+                    break;
+                }
+
+                push(")");
+                push(record.second);
+                push(" ");
+                push(text);
+                push(" ");
+                push(record.first);
+                out->append('(');
+                break;
+            case CachedNodeKind::UNARY:
+                if (compact) {
+                    lexeme('U', text);
+                    push(record.first);
+                    break;
+                }
+
+                push(")");
+                push(record.first);
+                push(" ");
+                push(text);
+                out->append('(');
+                break;
+            case CachedNodeKind::GROUPING:
+                if (compact) {
+                    out->append('G');
+                    push(record.first);
+                    break;
+                }
+
+                push(")");
+                push(record.first);
+                out->append('(');
+                break;
+            case CachedNodeKind::LET:
+                if (compact) {
+                    lexeme('L', text);
+                    push(record.first);
+                    break;
+                }
+
+                push(")");
+                push(record.first);
+                push(" ");
+                push(text);
+                out->append("(let ");
+                break;
+        }
+    }
+
+public:
+    // Statement `index` of `tree`, false (with part of it possibly written) on a damaged image.
+    // `start` is the first record of the statement, the one after the root of the statement before.
+    bool print(const CachedTree& tree, size_t index, uint32_t start, OutputBuffer& output, TreeFormat format = TreeFormat::SEXPR) {
+        uint32_t root = tree.statement(index);
+
+        if (root < start || root >= tree.nodeCount())
+            return false;
+
+        out = &output;
+        stack.clear();
+        push(root);
+
+        size_t budget = root - start + 1;
+        NodeRecord record;
+
+        while (!stack.empty()) {
+            Piece piece = stack.back();
+            stack.pop_back();
+
+            if (!piece.isNode) {
+                out->append(piece.text);
+                continue;
+            }
+
+            if (budget-- == 0 || piece.node < start || !tree.checkedNode(piece.node, record))
+                return false;
+
+            TokenInstance token = tree.nodeToken(record);
+
+            if (record.kind == CachedNodeKind::LITERAL)
+                literal(token, format);
+            else
+                expand(record, token.value, format);
+        }
+
+        return true;
+    }
+};
+
+// Directory of cache images named after a hash of the source bytes and of the compiler version.
+// Entries are written to a temporary file and renamed into place, so concurrent compiles of the
+// same input never see a partial image.
+class TreeCache {
+private:
+    std::string directory;
+
+public:
+    TreeCache(std::string _directory) : directory(std::move(_directory)) {}
+
+    // $GENESIS_CACHE_DIR, else $XDG_CACHE_HOME/genesis, else ~/.cache/genesis, else the temp directory
+    static std::string defaultDirectory() {
+        if (const char* explicitDirectory = std::getenv("GENESIS_CACHE_DIR"))
+            return explicitDirectory;
+
+        if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"))
+            return (std::filesystem::path(cacheHome) / "genesis").string();
+
+        if (const char* home = std::getenv("HOME"))
+            return (std::filesystem::path(home) / ".cache" / "genesis").string();
+
+        std::error_code code;
+        return (std::filesystem::temp_directory_path(code) / "genesis-cache").string();
+    }
+
+    std::string pathFor(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.gast", static_cast<unsigned long long>(key));
+
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    // Maps the entry for `source` (whose treeCacheKey is `key`) into `file` and opens `tree` over
+    // it. False on a miss or an unusable entry, which the next store() simply overwrites.
+    bool load(std::string_view source, uint64_t key, SourceBuffer& file, CachedTree& tree) const {
+        std::string path = pathFor(key);
+        std::error_code code;
+
+        if (!std::filesystem::is_regular_file(path, code) || !file.open(path.c_str()))
+            return false;
+
+        return tree.open(file.view(), source) && tree.key() == key;
+    }
+
+    bool store(uint64_t key, const std::string& image) const {
+        static const uint64_t processNonce = (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()();
+        static std::atomic<uint64_t> counter { 0 };
+
+        std::error_code code;
+        std::filesystem::create_directories(directory, code);
+
+        std::string path = pathFor(key);
+        std::string temporary = format("%s.%i.%i.tmp", path, static_cast<unsigned long long>(processNonce), static_cast<unsigned long long>(counter++));
+
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+
+        if (!file)
+            return false;
+
+        bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+        written = (std::fclose(file) == 0) && written;
+
+        if (written)
+            std::filesystem::rename(temporary, path, code);
+
+        if (!written || code) {
+            std::filesystem::remove(temporary, code);
+            return false;
+        }
+
+        return true;
+    }
+};
+
+// Cache images a long-running compile server keeps in memory in front of the TreeCache directory,
+// so a repeated input costs neither a file lookup nor a mapping. Entries are shared, an entry
+// evicted while a compile still reads it stays alive until that compile is done. The least
+// recently used entries go once more than `capacity` bytes are held.
+class MemoryTreeCache {
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> image;
+        uint64_t lastUse;
+    };
+
+    std::mutex lock;
+    std::unordered_map<uint64_t, Entry> entries;
+    size_t held = 0;
+    size_t capacity;
+    uint64_t clock = 0;
+
+public:
+    explicit MemoryTreeCache(size_t _capacity = size_t(256) << 20) : capacity(_capacity) {}
+
+    std::shared_ptr<const std::string> find(uint64_t key) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = entries.find(key);
+
+        if (found == entries.end())
+            return nullptr;
+
+        found->second.lastUse = ++clock;
+        return found->second.image;
+    }
+
+    void insert(uint64_t key, std::string image) {
+        if (image.size() > capacity)
+            return;
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = entries.find(key);
+
+        if (found != entries.end()) {
+            held -= found->second.image->size();
+            entries.erase(found);
+        }
+
+        while (held + image.size() > capacity) {
+            auto oldest = std::min_element(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.second.lastUse < b.second.lastUse; });
+            held -= oldest->second.image->size();
+            entries.erase(oldest);
+        }
+
+        held += image.size();
+        entries.emplace(key, Entry { std::make_shared<const std::string>(std::move(image)), ++clock });
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+    size_t bytes() {
+        std::lock_guard<std::mutex> guard(lock);
+        return held;
+    }
+};
+
+#endif // TREE_CACHE_GENESIS
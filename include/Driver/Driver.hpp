@@ -0,0 +1,587 @@
+#ifndef DRIVER_GENESIS
+#define DRIVER_GENESIS
+
+#include "../AST/Pipeline.hpp"
+#include "../AST/ParallelLexer.hpp"
+#include "../AST/Optimizer.hpp"
+#include "../AST/TreeCache.hpp"
+#include "../Util/SourceBuffer.hpp"
+#include "../VM/Compiler.hpp"
+#include "../VM/VM.hpp"
+#include "../Util/Stats.hpp"
+#include "./ThreadPool.hpp"
+#include <chrono>
+#include <filesystem>
+
+struct DriverOptions {
+    bool run = false;           // execute on the VM instead of dumping tokens and trees
+    bool optimize = false;      // run the AST optimization passes first
+    bool quiet = false;         // only diagnostics and the summary
+    size_t jobs = 0;            // worker threads, 0 for one per hardware thread
+    bool cache = true;          // reuse lexed and parsed inputs from the tree cache
+    bool verifyCache = false;   // re-parse cache hits anyway and replace entries that differ
+    std::string cacheDirectory = TreeCache::defaultDirectory();
+    bool stats = false;         // phase summary on stderr
+    std::string statsJson;      // phase records as JSON
+    std::string trace;          // phase records in Chrome trace-event format
+    TreeFormat treeFormat = TreeFormat::SEXPR;  // how trees are dumped
+    bool pipeline = false;      // lex each file on a second thread while it is parsed
+    size_t lexThreads = 1;      // threads lexing each file in chunks (0 for all), wins over pipeline
+    const std::string* standardInput = nullptr;     // read for "-" instead of stdin (server requests)
+    MemoryTreeCache* memoryCache = nullptr;         // cache images kept in memory between compiles
+    SymbolInterner* symbols = nullptr;              // names are interned into, compileAll owns one per run
+};
+
+// Everything one input produced. Nothing is printed while compiling so that output of
+// files compiled in parallel can still be written in input order.
+struct FileResult {
+    std::string path;
+    std::string output;
+    std::string diagnostics;
+    bool success = false;
+    bool cached = false;
+    size_t bytes = 0, tokens = 0, nodes = 0;
+};
+
+// load -> lex -> parse, or load from the tree cache (-> optimize) (-> compile -> run) for a single input
+inline FileResult compileFile(const std::string& path, const DriverOptions& options) {
+    FileResult result;
+    result.path = path;
+
+    SourceBuffer buffer;
+    GENESIS_PHASE(load, "load", path);
+
+    if (path == "-" && options.standardInput)
+        buffer = SourceBuffer(*options.standardInput);
+    else if (!buffer.open(path.c_str())) {
+        appendFormat(result.diagnostics, ">> Genesis:\nCould not open file at path '%s'...\n", path);
+        return result;
+    }
+
+    result.bytes = buffer.size();
+    GENESIS_PHASE_COUNT(load, bytes, buffer.size());
+    GENESIS_PHASE_END(load);
+
+    TreeCache cache(options.cacheDirectory);
+    uint64_t key = 0;
+    SourceBuffer cachedFile;
+    std::shared_ptr<const std::string> heldImage;
+    std::string_view cachedImage;
+    CachedTree cachedTree;
+
+    Arena arena;
+    std::vector<Statement*> statements;
+    // Only the passes after parsing look names up, dumps do not need symbols
+    SymbolInterner* symbols = (options.run || options.optimize) ? options.symbols : nullptr;
+
+    if (options.cache) {
+        GENESIS_PHASE(lookup, "cache_lookup", path);
+        key = treeCacheKey(buffer.view());
+
+        if (options.memoryCache) {
+            heldImage = options.memoryCache->find(key);
+            result.cached = heldImage && cachedTree.open(*heldImage, buffer.view()) && cachedTree.key() == key;
+        }
+
+        if (result.cached)
+            cachedImage = *heldImage;
+        else if ((result.cached = cache.load(buffer.view(), key, cachedFile, cachedTree))) {
+            cachedImage = cachedFile.view();
+
+            if (options.memoryCache)
+                options.memoryCache->insert(key, std::string(cachedImage));
+        }
+
+        GENESIS_PHASE_COUNT(lookup, bytes, buffer.size());
+    }
+
+    // A hit skips lexing and parsing. Dumps and the compiler read the tokens and node records
+    // straight out of the mapped entry, only the optimizer gets a tree built to rewrite. Records
+    // are checked as they are read, an entry found damaged on the way is dropped together with
+    // the output it produced and the input is parsed as on a miss (and the entry replaced).
+    bool inPlace = false;
+    Chunk cachedChunk;
+
+    if (result.cached && !options.verifyCache) {
+        size_t mark = result.output.size();
+        bool usable = true;
+        result.tokens = cachedTree.tokenCount();
+        result.nodes = cachedTree.nodeCount();
+
+        if (!options.run && !options.quiet) {
+            GENESIS_PHASE(dump, "dump_tokens", path);
+            TokenInstance token;
+
+            for (size_t i = 0; usable && i < cachedTree.tokenCount(); i++) {
+                if ((usable = cachedTree.checkedToken(i, token)))
+                    appendFormat(result.output, ">> Value: %s\n", token.value);
+            }
+
+            GENESIS_PHASE_COUNT(dump, tokens, cachedTree.tokenCount());
+        }
+
+        if (usable && options.optimize) {
+            GENESIS_PHASE(materialize, "cache_materialize", path);
+            usable = cachedTree.materialize(arena, statements, symbols);
+            GENESIS_PHASE_COUNT(materialize, nodes, arena.objectCount());
+        }
+        else if (usable && !options.run && !options.quiet) {
+            GENESIS_PHASE(dump, "dump_tree", path);
+            size_t before = result.output.size();
+            OutputBuffer output(std::move(result.output));
+            CachedTreePrinter printer;
+            uint32_t start = 0;
+
+            for (size_t i = 0; usable && i < cachedTree.statementCount(); i++) {
+                usable = printer.print(cachedTree, i, start, output, options.treeFormat);
+                output.append('\n');
+                start = cachedTree.statement(i) + 1;
+            }
+
+            result.output = output.take();
+            GENESIS_PHASE_COUNT(dump, bytes, result.output.size() - before);
+            GENESIS_PHASE_COUNT(dump, nodes, result.nodes);
+        }
+        else if (usable && options.run) {
+            GENESIS_PHASE(compile, "compile", path);
+
+            try {
+                usable = Compiler().compile(cachedTree, cachedChunk);
+            }
+            catch(CompilerException& e) {
+                appendFormat(result.diagnostics, ">> GenesisException:\n>> Message: %s\n", e.message);
+                return result;
+            }
+
+            GENESIS_PHASE_COUNT(compile, nodes, result.nodes);
+        }
+
+        inPlace = usable && !options.optimize;
+
+        if (!usable) {
+            result.output.resize(mark);
+            result.cached = false;
+            statements.clear();
+            arena.release();
+            appendFormat(result.diagnostics, ">> Cache: entry %s is damaged, replaced\n", cache.pathFor(key));
+        }
+    }
+
+    if (!result.cached || options.verifyCache) {
+        TokenStore tokens;
+        Diagnostics problems;
+
+        if (options.pipeline && options.lexThreads == 1) {
+            // Lexing and parsing overlap, so they are timed as one phase
+            GENESIS_PHASE(lexParse, "lex_parse", path);
+            PipelinedLexer lexer(buffer.view(), symbols);
+            Parser parser(lexer, arena);
+
+            statements = parser.compile();
+            lexer.finish();
+
+            tokens = std::move(lexer.tokens());
+            problems.append(lexer.diagnostics());
+            problems.append(parser.diagnostics());
+
+            GENESIS_PHASE_COUNT(lexParse, bytes, buffer.size());
+            GENESIS_PHASE_COUNT(lexParse, tokens, tokens.size());
+            GENESIS_PHASE_COUNT(lexParse, nodes, arena.objectCount());
+        }
+        else {
+            GENESIS_PHASE(lex, "lex", path);
+
+            if (options.lexThreads != 1) {
+                ParallelLexer lexer(buffer.view(), symbols, options.lexThreads);
+                tokens = lexer.compileStore();
+                problems.append(lexer.diagnostics());
+            }
+            else {
+                Lexer lexer(buffer.view(), symbols);
+                tokens = lexer.compileStore();
+                problems.append(lexer.diagnostics());
+            }
+
+            GENESIS_PHASE_COUNT(lex, bytes, buffer.size());
+            GENESIS_PHASE_COUNT(lex, tokens, tokens.size());
+            GENESIS_PHASE_END(lex);
+
+            TokenStoreReader reader(tokens);
+            Parser parser(reader, arena);
+            GENESIS_PHASE(parse, "parse", path);
+
+            statements = parser.compile();
+            problems.append(parser.diagnostics());
+
+            GENESIS_PHASE_COUNT(parse, tokens, tokens.size());
+            GENESIS_PHASE_COUNT(parse, nodes, arena.objectCount());
+        }
+
+        result.tokens = tokens.size();
+
+        if (!options.run && !options.quiet) {
+            GENESIS_PHASE(dump, "dump_tokens", path);
+
+            for (size_t i = 0; i < tokens.size(); i++)
+                appendFormat(result.output, ">> Value: %s\n", tokens.lexeme(i));
+
+            GENESIS_PHASE_COUNT(dump, tokens, tokens.size());
+        }
+
+        // Everything wrong with the input is reported at once, broken inputs are never cached or run
+        if (!problems.empty()) {
+            result.diagnostics += problems.render(buffer.view());
+            return result;
+        }
+
+        if (options.cache) {
+            GENESIS_PHASE(store, "cache_store", path);
+            std::string image = serializeTree(buffer.view(), key, tokens, statements);
+
+            if (result.cached && image != cachedImage) {
+                appendFormat(result.diagnostics, ">> Cache: entry %s does not match a fresh parse, replaced\n", cache.pathFor(key));
+                result.cached = false;
+            }
+
+            if (!result.cached && !cache.store(key, image))
+                appendFormat(result.diagnostics, ">> Cache: could not write %s\n", cache.pathFor(key));
+
+            GENESIS_PHASE_COUNT(store, bytes, image.size());
+
+            if (!result.cached && options.memoryCache)
+                options.memoryCache->insert(key, std::move(image));
+        }
+    }
+
+    if (!inPlace)
+        result.nodes = arena.objectCount();
+
+    if (options.optimize) {
+        GENESIS_PHASE(optimize, "optimize", path);
+        OptimizerReport report = Optimizer(arena).run(statements);
+        appendFormat(result.diagnostics, ">> Optimizer: removed %i of %i nodes\n", report.removed(), report.nodesBefore);
+        GENESIS_PHASE_COUNT(optimize, nodes, report.nodesBefore);
+    }
+
+    if (!options.run) {
+        if (!options.quiet && !inPlace) {
+            GENESIS_PHASE(dump, "dump_tree", path);
+            [[maybe_unused]] size_t before = result.output.size();
+            OutputBuffer output(std::move(result.output));
+            TreePrinter printer;
+
+            for (auto statement : statements) {
+                printer.print(statement, output, options.treeFormat);
+                output.append('\n');
+            }
+
+            result.output = output.take();
+            GENESIS_PHASE_COUNT(dump, bytes, result.output.size() - before);
+            GENESIS_PHASE_COUNT(dump, nodes, result.nodes);
+        }
+
+        result.success = true;
+        return result;
+    }
+
+    try {
+        Chunk chunk = std::move(cachedChunk);
+
+        if (!inPlace) {
+            GENESIS_PHASE(compile, "compile", path);
+            chunk = Compiler().compile(statements);
+            GENESIS_PHASE_COUNT(compile, nodes, result.nodes);
+        }
+
+        GENESIS_PHASE(run, "run", path);
+        VM vm;
+        Value value = vm.run(chunk);
+        GENESIS_PHASE_END(run);
+
+        if (!options.quiet) {
+            result.output += value.toString();
+            result.output += '\n';
+        }
+
+        result.success = true;
+    }
+    catch(CompilerException& e) {
+        appendFormat(result.diagnostics, ">> GenesisException:\n>> Message: %s\n", e.message);
+    }
+    catch(RuntimeException& e) {
+        appendFormat(result.diagnostics, ">> GenesisRuntimeException:\n>> Message: %s\n", e.message);
+    }
+
+    return result;
+}
+
+// Expands the command line inputs: plain paths (or "-") are kept, directories are walked
+// recursively in sorted order and "@list" reads one path per line (blank and '#' lines skipped).
+inline bool collectInputs(const std::vector<std::string>& arguments, std::vector<std::string>& inputs, std::string& error) {
+    namespace fs = std::filesystem;
+
+    for (auto& argument : arguments) {
+        if (argument.size() > 1 && argument[0] == '@') {
+            std::ifstream list(argument.substr(1));
+
+            if (!list.is_open()) {
+                error = format("Could not open response file '%s'...", argument.substr(1));
+                return false;
+            }
+
+            std::vector<std::string> listed;
+            std::string line;
+
+            while (std::getline(list, line)) {
+                while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+                    line.pop_back();
+
+                if (!line.empty() && line[0] != '#')
+                    listed.push_back(line);
+            }
+
+            if (!collectInputs(listed, inputs, error))
+                return false;
+
+            continue;
+        }
+
+        std::error_code code;
+
+        if (argument != "-" && fs::is_directory(argument, code)) {
+            std::vector<std::string> found;
+
+            for (auto& entry : fs::recursive_directory_iterator(argument, code)) {
+                if (entry.is_regular_file(code))
+                    found.push_back(entry.path().string());
+            }
+
+            std::sort(found.begin(), found.end());
+            inputs.insert(inputs.end(), found.begin(), found.end());
+            continue;
+        }
+
+        inputs.push_back(argument);
+    }
+
+    return true;
+}
+
+// Writes whatever --stats, --stats-json and --trace asked for once every phase has been recorded
+inline bool writeStats(const DriverOptions& options, OutputBuffer& standardError) {
+#ifdef GENESIS_NO_STATS
+    if (options.stats || !options.statsJson.empty() || !options.trace.empty())
+        standardError.append(">> Genesis:\nThis build was compiled with GENESIS_NO_STATS, no stats were recorded...\n");
+
+    return true;
+#else
+    if (options.stats)
+        standardError.append(Stats::collector().summary());
+
+    auto write = [&](const std::string& path, const std::string& text) {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << text;
+
+        if (!file) {
+            standardError.append(format(">> Genesis:\nCould not write '%s'...\n", path));
+            return false;
+        }
+
+        return true;
+    };
+
+    bool written = true;
+
+    if (!options.statsJson.empty())
+        written = write(options.statsJson, Stats::collector().json()) && written;
+
+    if (!options.trace.empty())
+        written = write(options.trace, Stats::collector().trace()) && written;
+
+    return written;
+#endif
+}
+
+// Compiles every input on a work-stealing pool. Results are written in input order as soon as
+// all earlier inputs are done, followed by an aggregate summary on stderr. Returns the exit code.
+inline int compileAll(const std::vector<std::string>& inputs, const DriverOptions& options, OutputBuffer& standardOutput, OutputBuffer& standardError) {
+    auto start = std::chrono::steady_clock::now();
+
+#ifndef GENESIS_NO_STATS
+    if (options.stats || !options.statsJson.empty() || !options.trace.empty())
+        Stats::collector().enable();
+#endif
+
+    std::vector<FileResult> results(inputs.size());
+    std::vector<uint8_t> finished(inputs.size(), 0);
+    std::mutex finishedLock;
+    std::condition_variable finishedSignal;
+
+    // Biggest inputs first so one large file does not end up as the last task of a run
+    std::vector<size_t> order(inputs.size());
+    std::vector<uintmax_t> sizes(inputs.size(), 0);
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::error_code code;
+        order[i] = i;
+        sizes[i] = inputs[i] == "-" ? 0 : std::filesystem::file_size(inputs[i], code);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    // A single input is compiled right here, starting a worker for it would only add latency
+    size_t workers = std::min(options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency()), inputs.size());
+    std::unique_ptr<ThreadPool> pool;
+
+    // Symbols are only compared within a run, so every run (and server request) gets its own
+    // table and the names it interned go away with it
+    std::unique_ptr<ConcurrentSymbolTable> symbols;
+    DriverOptions fileOptions = options;
+
+    if ((options.run || options.optimize) && !options.symbols) {
+        symbols = std::make_unique<ConcurrentSymbolTable>();
+        fileOptions.symbols = symbols.get();
+    }
+
+    auto compileInput = [&](size_t index) {
+        FileResult result = compileFile(inputs[index], fileOptions);
+
+        std::lock_guard<std::mutex> guard(finishedLock);
+        results[index] = std::move(result);
+        finished[index] = 1;
+        finishedSignal.notify_all();
+    };
+
+    if (inputs.size() == 1)
+        compileInput(0);
+    else {
+        pool = std::make_unique<ThreadPool>(std::max<size_t>(1, workers));
+
+        for (size_t index : order)
+            pool->submit([&, index]() { compileInput(index); });
+    }
+
+    size_t succeeded = 0, cached = 0, bytes = 0, tokens = 0, nodes = 0;
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        FileResult result;
+
+        {
+            std::unique_lock<std::mutex> guard(finishedLock);
+            finishedSignal.wait(guard, [&]() { return finished[i] != 0; });
+            result = std::move(results[i]);
+        }
+
+        if (!result.output.empty()) {
+            if (inputs.size() > 1) {
+                standardOutput.append(">> File: ");
+                standardOutput.append(result.path);
+                standardOutput.append('\n');
+            }
+
+            standardOutput.append(result.output);
+        }
+
+        if (!result.diagnostics.empty()) {
+            // Keeps the dump ahead of its diagnostics and the diagnostics unbuffered, like std::cerr
+            standardOutput.flush();
+
+            if (inputs.size() > 1) {
+                standardError.append(">> File: ");
+                standardError.append(result.path);
+                standardError.append('\n');
+            }
+
+            standardError.append(result.diagnostics);
+            standardError.flush();
+        }
+
+        succeeded += result.success;
+        cached += result.cached;
+        bytes += result.bytes;
+        tokens += result.tokens;
+        nodes += result.nodes;
+    }
+
+    if (pool)
+        pool->wait();
+
+    standardOutput.flush();
+
+    if (inputs.size() > 1) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        standardError.append(format(">> Summary: %i files, %i succeeded, %i failed, %i cached, %i bytes, %i tokens, %i nodes, %i threads, %d s, %d MB/s\n",
+            inputs.size(), succeeded, inputs.size() - succeeded, cached, bytes, tokens, nodes, pool->size(),
+            elapsed.count(), bytes / (1024.0 * 1024.0) / std::max(elapsed.count(), 1e-9)));
+    }
+
+    bool written = writeStats(options, standardError);
+    standardError.flush();
+
+    return written && succeeded == inputs.size() ? 0 : 1;
+}
+
+// Everything the Genesis executable does with its command line (without argv[0]), on top of
+// `options`. Output goes to the two buffers, the exit code is returned.
+inline int runGenesis(const std::vector<std::string>& commandLine, DriverOptions options, OutputBuffer& standardOutput, OutputBuffer& standardError) {
+    // --run executes the inputs on the VM instead of dumping their tokens and trees, --optimize
+    // runs the AST optimization passes before either. Inputs may be files, directories or @lists.
+    // Parsed inputs are kept in a tree cache (--no-cache, --verify-cache, --cache-dir <path>).
+    // --stats, --stats-json <file> and --trace <file> report where the time of every phase went.
+    // --tree-format sexpr|compact picks how trees are dumped.
+    // --pipeline lexes every file on a second thread while the parser consumes its tokens.
+    // --lex-threads N lexes every large file in N chunks at once, 0 for one per hardware thread.
+    std::vector<std::string> arguments;
+    size_t count = commandLine.size();
+
+    for (size_t i = 0; i < count; i++) {
+        std::string_view argument = commandLine[i];
+
+        if (argument == "--run")
+            options.run = true;
+        else if (argument == "--optimize")
+            options.optimize = true;
+        else if (argument == "--quiet")
+            options.quiet = true;
+        else if (argument == "--jobs" && i + 1 < count)
+            options.jobs = std::strtoul(commandLine[++i].c_str(), nullptr, 10);
+        else if (argument == "--no-cache")
+            options.cache = false;
+        else if (argument == "--verify-cache")
+            options.verifyCache = true;
+        else if (argument == "--cache-dir" && i + 1 < count)
+            options.cacheDirectory = commandLine[++i];
+        else if (argument == "--stats")
+            options.stats = true;
+        else if (argument == "--stats-json" && i + 1 < count)
+            options.statsJson = commandLine[++i];
+        else if (argument == "--trace" && i + 1 < count)
+            options.trace = commandLine[++i];
+        else if (argument == "--pipeline")
+            options.pipeline = true;
+        else if (argument == "--lex-threads" && i + 1 < count)
+            options.lexThreads = std::strtoul(commandLine[++i].c_str(), nullptr, 10);
+        else if (argument == "--tree-format" && i + 1 < count)
+            options.treeFormat = commandLine[++i] == "compact" ? TreeFormat::COMPACT : TreeFormat::SEXPR;
+        else
+            arguments.push_back(commandLine[i]);
+    }
+
+    std::vector<std::string> inputs;
+    std::string error;
+
+    if (!collectInputs(arguments, inputs, error)) {
+        standardError.append(format(">> Genesis:\n%s\n", error));
+        return 1;
+    }
+
+    if (inputs.empty()) {
+        standardError.append(">> Genesis:\nNo file path found or supplied to compiler...\n");
+        return 1;
+    }
+
+    return compileAll(inputs, options, standardOutput, standardError);
+}
+
+#endif // DRIVER_GENESIS
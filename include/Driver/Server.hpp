@@ -0,0 +1,368 @@
+#ifndef SERVER_GENESIS
+#define SERVER_GENESIS
+
+#include "./Driver.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GENESIS_SERVER 1
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// Frames exchanged by the compile server and its clients. A frame is a 4 byte little-endian
+// length followed by that many bytes of payload, the payload a sequence of fields that are each
+// a 4 byte length followed by their bytes.
+//
+// Requests:  "compile", working directory, standard input, Genesis arguments...
+//            "ping"
+//            "shutdown"
+// Responses: exit code, stdout, stderr
+namespace Protocol {
+    // Frames beyond this are refused instead of allocated
+    constexpr size_t maxFrame = size_t(1) << 30;
+
+    inline void appendLength(std::string& out, size_t length) {
+        for (int i = 0; i < 4; i++)
+            out += static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+
+    inline uint32_t readLength(const char* bytes) {
+        uint32_t length = 0;
+
+        for (int i = 0; i < 4; i++)
+            length |= uint32_t(static_cast<uint8_t>(bytes[i])) << (8 * i);
+
+        return length;
+    }
+
+    inline void appendField(std::string& payload, std::string_view field) {
+        appendLength(payload, field.size());
+        payload.append(field);
+    }
+
+    // Takes the next field off the front of `payload`, false once it is empty or malformed
+    inline bool nextField(std::string_view& payload, std::string_view& field) {
+        if (payload.size() < 4)
+            return false;
+
+        uint32_t length = readLength(payload.data());
+
+        if (payload.size() - 4 < length)
+            return false;
+
+        field = payload.substr(4, length);
+        payload.remove_prefix(4 + length);
+
+        return true;
+    }
+
+    inline std::vector<std::string_view> fields(std::string_view payload) {
+        std::vector<std::string_view> result;
+        std::string_view field;
+
+        while (nextField(payload, field))
+            result.push_back(field);
+
+        return result;
+    }
+
+#ifdef GENESIS_SERVER
+    inline bool readExactly(int descriptor, char* out, size_t size) {
+        while (size) {
+            ssize_t count = ::read(descriptor, out, size);
+
+            if (count < 0 && errno == EINTR)
+                continue;
+
+            if (count <= 0)
+                return false;
+
+            out += count;
+            size -= count;
+        }
+
+        return true;
+    }
+
+    inline bool writeExactly(int descriptor, const char* bytes, size_t size) {
+        while (size) {
+            ssize_t count = ::write(descriptor, bytes, size);
+
+            if (count < 0 && errno == EINTR)
+                continue;
+
+            if (count <= 0)
+                return false;
+
+            bytes += count;
+            size -= count;
+        }
+
+        return true;
+    }
+
+    // False at the end of the stream or on a broken frame
+    inline bool readFrame(int descriptor, std::string& payload) {
+        char header[4];
+
+        if (!readExactly(descriptor, header, 4))
+            return false;
+
+        uint32_t length = readLength(header);
+
+        if (length > maxFrame)
+            return false;
+
+        payload.resize(length);
+        return readExactly(descriptor, payload.data(), length);
+    }
+
+    inline bool writeFrame(int descriptor, std::string_view payload) {
+        if (payload.size() > maxFrame)
+            return false;
+
+        std::string header;
+        appendLength(header, payload.size());
+
+        return writeExactly(descriptor, header.data(), 4) && writeExactly(descriptor, payload.data(), payload.size());
+    }
+#endif
+}
+
+#ifdef GENESIS_SERVER
+// Where clients look for a server without --socket: $GENESIS_SERVER_SOCKET, else a per-user
+// socket in the temporary directory
+inline std::string defaultServerSocket() {
+    if (const char* path = std::getenv("GENESIS_SERVER_SOCKET"); path && *path)
+        return path;
+
+    std::error_code code;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(code);
+
+    if (code)
+        directory = "/tmp";
+
+    return (directory / ("genesis-" + std::to_string(::getuid()) + ".sock")).string();
+}
+
+inline bool socketAddress(const std::string& path, sockaddr_un& address) {
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    return true;
+}
+
+// A descriptor connected to the server at `path`, -1 if none answers there
+inline int connectToServer(const std::string& path) {
+    sockaddr_un address;
+
+    if (!socketAddress(path, address))
+        return -1;
+
+    int descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (descriptor < 0)
+        return -1;
+
+    if (::connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(descriptor);
+        return -1;
+    }
+
+    return descriptor;
+}
+
+// Compiles requests for as long as it runs, so a run of many small compiles pays process
+// startup only once. Between requests it keeps the arenas and buffers the allocator already
+// handed out and every parsed input as a cache image in memory (in front of the usual tree cache
+// directory), so a file seen before is neither read from disk nor parsed. Symbols are not kept,
+// each request interns into a table of its own.
+//
+// Requests run one at a time: each one changes into the working directory of its client and
+// resets the stats, both of which belong to the whole process. A request compiling several
+// inputs still spreads them over threads as usual.
+class CompileServer {
+private:
+    MemoryTreeCache memoryCache;
+    std::mutex requestLock;
+    std::atomic<bool> stopping { false };
+
+    std::mutex connectionLock;
+    std::condition_variable connectionsDone;
+    std::vector<int> connections;
+    std::atomic<int> listener { -1 };
+
+    std::string respond(int code, std::string_view output, std::string_view errors) {
+        std::string payload;
+        Protocol::appendField(payload, std::to_string(code));
+        Protocol::appendField(payload, output);
+        Protocol::appendField(payload, errors);
+
+        return payload;
+    }
+
+    std::string compile(const std::vector<std::string_view>& request) {
+        if (request.size() < 3)
+            return respond(2, "", ">> Genesis:\nMalformed compile request...\n");
+
+        std::lock_guard<std::mutex> guard(requestLock);
+        std::error_code code;
+        std::filesystem::current_path(std::string(request[1]), code);
+
+        if (code)
+            return respond(1, "", format(">> Genesis:\nCould not change into '%s'...\n", request[1]));
+
+        // "-" reads what the client sent, never the stdin of the server
+        std::string input(request[2]);
+        std::vector<std::string> arguments(request.begin() + 3, request.end());
+
+        DriverOptions options;
+        options.memoryCache = &memoryCache;
+        options.standardInput = &input;
+
+        OutputBuffer output, errors;
+        int exitCode = 1;
+
+        try {
+            exitCode = runGenesis(arguments, options, output, errors);
+        }
+        catch (const std::exception& error) {
+            errors.append(format(">> Genesis:\nInternal error: %s\n", error.what()));
+        }
+
+#ifndef GENESIS_NO_STATS
+        Stats::collector().reset();
+#endif
+
+        return respond(exitCode, output.view(), errors.view());
+    }
+
+    void serveConnection(int descriptor) {
+        serveStream(descriptor, descriptor);
+        ::close(descriptor);
+
+        std::lock_guard<std::mutex> guard(connectionLock);
+        connections.erase(std::find(connections.begin(), connections.end(), descriptor));
+        connectionsDone.notify_all();
+    }
+
+public:
+    CompileServer() = default;
+
+    CompileServer(const CompileServer&) = delete;
+    CompileServer& operator=(const CompileServer&) = delete;
+
+    // Handles one request payload and returns the response payload. Sets stopping() on "shutdown".
+    std::string handle(std::string_view payload) {
+        std::vector<std::string_view> request = Protocol::fields(payload);
+
+        if (request.empty())
+            return respond(2, "", ">> Genesis:\nEmpty request...\n");
+
+        if (request[0] == "compile")
+            return compile(request);
+
+        if (request[0] == "ping")
+            return respond(0, format("genesis server, %i cached inputs, %i bytes\n", memoryCache.size(), memoryCache.bytes()), "");
+
+        if (request[0] == "shutdown") {
+            stop();
+            return respond(0, "", "");
+        }
+
+        return respond(2, "", format(">> Genesis:\nUnknown request '%s'...\n", request[0]));
+    }
+
+    // Answers frames read from `input` on `output` until the stream ends or a shutdown came in
+    void serveStream(int input, int output) {
+        std::string request;
+
+        while (!stopping && Protocol::readFrame(input, request)) {
+            if (!Protocol::writeFrame(output, handle(request)))
+                break;
+        }
+    }
+
+    // Listens on the Unix socket at `path` until a shutdown request, one thread per connection.
+    // A stale socket left by an earlier server is replaced, a live one is an error.
+    bool serveSocket(const std::string& path, std::string& error) {
+        sockaddr_un address;
+
+        if (!socketAddress(path, address)) {
+            error = format("Socket path '%s' is too long...", path);
+            return false;
+        }
+
+        if (int other = connectToServer(path); other >= 0) {
+            ::close(other);
+            error = format("A server is already listening on '%s'...", path);
+            return false;
+        }
+
+        // Clients that hang up early must not take the server down with them
+        std::signal(SIGPIPE, SIG_IGN);
+
+        ::unlink(path.c_str());
+        int descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (descriptor < 0 || ::bind(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(descriptor, 64) != 0) {
+            error = format("Could not listen on '%s': %s...", path, std::strerror(errno));
+
+            if (descriptor >= 0)
+                ::close(descriptor);
+
+            return false;
+        }
+
+        listener = descriptor;
+
+        while (!stopping) {
+            int connection = ::accept(listener, nullptr, nullptr);
+
+            if (connection < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+
+                break;
+            }
+
+            std::lock_guard<std::mutex> guard(connectionLock);
+            connections.push_back(connection);
+            std::thread([this, connection]() { serveConnection(connection); }).detach();
+        }
+
+        ::unlink(path.c_str());
+
+        std::unique_lock<std::mutex> guard(connectionLock);
+        connectionsDone.wait(guard, [&]() { return connections.empty(); });
+        ::close(listener.exchange(-1));
+
+        return true;
+    }
+
+    // Stops taking requests: an accept() in serveSocket() returns right away and idle connections
+    // see the end of their stream, a response being written still goes out
+    void stop() {
+        stopping = true;
+
+        if (int descriptor = listener; descriptor >= 0)
+            ::shutdown(descriptor, SHUT_RDWR);
+
+        std::lock_guard<std::mutex> guard(connectionLock);
+
+        for (int connection : connections)
+            ::shutdown(connection, SHUT_RD);
+    }
+
+    bool stopped() const {
+        return stopping;
+    }
+};
+#endif
+
+#endif // SERVER_GENESIS
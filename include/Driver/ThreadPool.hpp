@@ -0,0 +1,140 @@
+#ifndef THREAD_POOL_GENESIS
+#define THREAD_POOL_GENESIS
+
+#include "../Util/Source.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Work-stealing pool. Every worker owns a deque: it pops its own work from the back and, once that
+// runs dry, steals from the front of the other workers' deques, so a few large tasks landing on
+// one worker do not leave the others idle.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateLock;
+    std::condition_variable wakeUp, allDone;
+    std::atomic<size_t> queued { 0 }, unfinished { 0 }, nextQueue { 0 };
+    bool stopping = false;
+
+    bool take(size_t self, Task& task) {
+        {
+            Queue& own = *queues[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < queues.size(); offset++) {
+            Queue& victim = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void work(size_t self) {
+        while (true) {
+            Task task;
+
+            if (take(self, task)) {
+                queued--;
+                task();
+
+                if (--unfinished == 0) {
+                    std::lock_guard<std::mutex> guard(stateLock);
+                    allDone.notify_all();
+                }
+
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(stateLock);
+            wakeUp.wait(guard, [&]() { return stopping || queued > 0; });
+
+            if (stopping && queued == 0)
+                return;
+        }
+    }
+
+public:
+    // 0 threads means one per hardware thread
+    ThreadPool(size_t threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (size_t i = 0; i < threads; i++)
+            queues.push_back(std::make_unique<Queue>());
+
+        for (size_t i = 0; i < threads; i++)
+            workers.emplace_back([this, i]() { work(i); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            stopping = true;
+        }
+
+        wakeUp.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    void submit(Task task) {
+        Queue& queue = *queues[nextQueue++ % queues.size()];
+        unfinished++;
+
+        // Counted before it is visible, so a worker can never take it and decrement first
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            queued++;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        wakeUp.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> guard(stateLock);
+        allDone.wait(guard, [&]() { return unfinished == 0; });
+    }
+};
+
+#endif // THREAD_POOL_GENESIS
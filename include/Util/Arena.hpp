@@ -0,0 +1,128 @@
+#ifndef ARENA_GENESIS
+#define ARENA_GENESIS
+
+#include "Source.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Bump allocator owning every node of one compilation unit. Objects are never freed one by
+// one, the whole arena is released at once when it is destroyed (or release() is called).
+// Types with a non-trivial destructor are still destroyed, in reverse order of creation.
+class Arena {
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    static constexpr size_t maxBlockSize = 4 * 1024 * 1024;
+
+    size_t firstBlockSize = 64 * 1024;
+    std::vector<Block> blocks;
+    std::vector<Finalizer> finalizers;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t used = 0, reserved = 0, objects = 0;
+
+    void grow(size_t minimum) {
+        size_t size = blocks.empty() ? firstBlockSize : std::min(blocks.back().size * 2, maxBlockSize);
+
+        if (size < minimum)
+            size = minimum;
+
+        // Through operator new rather than malloc, so allocation counters see the blocks too
+        char* data = static_cast<char*>(::operator new(size));
+
+        blocks.push_back({data, size});
+        cursor = data;
+        limit = data + size;
+        reserved += size;
+    }
+
+public:
+    Arena() = default;
+    // Small arenas for short-lived units, e.g. the few statements re-parsed after an edit
+    explicit Arena(size_t _firstBlockSize) : firstBlockSize(std::max<size_t>(_firstBlockSize, 256)) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() { release(); }
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        size_t padding = (alignment - (reinterpret_cast<uintptr_t>(cursor) & (alignment - 1))) & (alignment - 1);
+
+        if (!cursor || cursor + padding + size > limit) {
+            grow(size + alignment);
+            padding = (alignment - (reinterpret_cast<uintptr_t>(cursor) & (alignment - 1))) & (alignment - 1);
+        }
+
+        char* result = cursor + padding;
+        cursor = result + size;
+        used += padding + size;
+
+        return result;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        objects++;
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            finalizers.push_back({[](void* self) { static_cast<T*>(self)->~T(); }, object});
+
+        return object;
+    }
+
+    // Copies `text` into the arena, for lexemes that do not exist in any SourceBuffer
+    std::string_view copy(std::string_view text) {
+        char* data = static_cast<char*>(allocate(text.size() + 1, 1));
+
+        std::copy(text.begin(), text.end(), data);
+        data[text.size()] = '\0';
+
+        return std::string_view(data, text.size());
+    }
+
+    void release() {
+        for (auto i = finalizers.rbegin(); i != finalizers.rend(); i++)
+            i->destroy(i->object);
+
+        for (auto& block : blocks)
+            ::operator delete(block.data);
+
+        finalizers.clear();
+        blocks.clear();
+        cursor = limit = nullptr;
+        used = reserved = objects = 0;
+    }
+
+    // Bytes handed out so far, alignment padding included
+    size_t bytesUsed() const {
+        return used;
+    }
+
+    // Bytes requested from the system allocator
+    size_t bytesReserved() const {
+        return reserved;
+    }
+
+    size_t objectCount() const {
+        return objects;
+    }
+
+    // Blocks taken from the heap so far
+    size_t blockCount() const {
+        return blocks.size();
+    }
+};
+
+#endif // ARENA_GENESIS
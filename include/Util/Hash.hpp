@@ -0,0 +1,45 @@
+#ifndef HASH_GENESIS
+#define HASH_GENESIS
+
+#include "Source.hpp"
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hash of a byte range, 16 bytes per step folded through a
+// 64x64->128 bit multiply (in the style of wyhash). Used to key caches, not for security.
+namespace Hash {
+    inline uint64_t fold(uint64_t a, uint64_t b) {
+        __uint128_t product = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+
+    inline uint64_t load(const char* at) {
+        uint64_t value;
+        std::memcpy(&value, at, sizeof(value));
+        return value;
+    }
+
+    constexpr uint64_t k0 = 0xa0761d6478bd642full;
+    constexpr uint64_t k1 = 0xe7037ed1a0b428dbull;
+    constexpr uint64_t k2 = 0x8ebc6af09c88c6e3ull;
+}
+
+inline uint64_t hashBytes(std::string_view bytes, uint64_t seed = 0) {
+    const char* at = bytes.data();
+    size_t remaining = bytes.size();
+    uint64_t state = Hash::fold(seed ^ Hash::k0, Hash::k1) ^ bytes.size();
+
+    while (remaining >= 16) {
+        state = Hash::fold(Hash::load(at) ^ Hash::k1, Hash::load(at + 8) ^ state);
+        at += 16;
+        remaining -= 16;
+    }
+
+    char tail[16] = {};
+    std::memcpy(tail, at, remaining);
+    state = Hash::fold(Hash::load(tail) ^ Hash::k1, Hash::load(tail + 8) ^ state ^ Hash::k2);
+
+    return Hash::fold(state ^ Hash::k0, bytes.size() ^ Hash::k2);
+}
+
+#endif // HASH_GENESIS
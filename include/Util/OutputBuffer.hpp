@@ -0,0 +1,109 @@
+#ifndef OUTPUT_BUFFER_GENESIS
+#define OUTPUT_BUFFER_GENESIS
+
+#include "Source.hpp"
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <unistd.h>
+#define GENESIS_OUTPUT_FD 1
+#endif
+
+// Growable output buffer that is appended to instead of building a temporary string per piece.
+// Without a descriptor it only grows and its text is taken at the end, with one it writes itself
+// out in chunks of `chunkSize` bytes and at flush() (or destruction), so dumps of any size need a
+// bounded amount of memory and only a write call per chunk.
+class OutputBuffer {
+private:
+    std::string data;
+    int descriptor = -1;
+    size_t chunkSize = 1 << 16;
+    bool failed = false;
+
+    void writeOut(std::string_view bytes) {
+#ifdef GENESIS_OUTPUT_FD
+        while (!bytes.empty()) {
+            ssize_t count = ::write(descriptor, bytes.data(), bytes.size());
+
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                failed = true;
+                return;
+            }
+
+            bytes.remove_prefix(count);
+        }
+#else
+        std::FILE* stream = descriptor == 2 ? stderr : stdout;
+        failed = std::fwrite(bytes.data(), 1, bytes.size(), stream) != bytes.size() || failed;
+        std::fflush(stream);
+#endif
+    }
+
+public:
+    OutputBuffer() = default;
+    // Continues after `text`, e.g. a result that already holds the token dump
+    explicit OutputBuffer(std::string text) : data(std::move(text)) {}
+    // Writes to `_descriptor` (1 for stdout), never holding much more than `_chunkSize` bytes
+    explicit OutputBuffer(int _descriptor, size_t _chunkSize = 1 << 16) : descriptor(_descriptor), chunkSize(_chunkSize) {
+        data.reserve(chunkSize);
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer() { flush(); }
+
+    void append(std::string_view text) {
+        data.append(text);
+
+        if (descriptor >= 0 && data.size() >= chunkSize)
+            flush();
+    }
+
+    void append(char c) {
+        data += c;
+
+        if (descriptor >= 0 && data.size() >= chunkSize)
+            flush();
+    }
+
+    void appendNumber(uint64_t value) {
+        char digits[20];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+
+        append(std::string_view(digits, end - digits));
+    }
+
+    // Bytes held and not written yet
+    size_t size() const {
+        return data.size();
+    }
+
+    std::string_view view() const {
+        return data;
+    }
+
+    // The text so far, the buffer is empty afterwards
+    std::string take() {
+        std::string text = std::move(data);
+        data.clear();
+
+        return text;
+    }
+
+    // False once a write failed
+    bool flush() {
+        if (descriptor >= 0 && !data.empty()) {
+            writeOut(data);
+            data.clear();
+        }
+
+        return !failed;
+    }
+};
+
+#endif // OUTPUT_BUFFER_GENESIS
@@ -10,78 +10,212 @@
 #include <algorithm>
 #include <unordered_map>
 #include <variant>
+#include <optional>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
 
 #define debug(...) std::cout << __VA_ARGS__ << std::endl;
 
-using formatValues = std::variant<int, double, char, const char*, std::string, bool>;
+// Part of every cache key, bump it whenever the lexer or parser output changes
+#ifndef GENESIS_VERSION
+#define GENESIS_VERSION "0.2.0"
+#endif
 
-std::string format(std::string input, std::vector<formatValues> args) {
-    std::string output = input;
-    int current = 0, argc = 0;
+#if defined(__cpp_consteval)
+#define GENESIS_CONSTEVAL consteval
+#else
+#define GENESIS_CONSTEVAL constexpr
+#endif
 
-    while (current < input.size()) {
-        if (input[current] == '%') {
-            // Check if the next character is a valid format specifier
-            if (current + 1 >= input.size())
-                break;
+// One formatted argument, type-erased without touching the heap
+struct FormatArg {
+    enum Kind { INTEGER, UNSIGNED, FLOATING, CHARACTER, BOOLEAN, TEXT } kind;
+
+    union {
+        long long integer;
+        unsigned long long natural;
+        double floating;
+        char character;
+        bool boolean;
+    };
+
+    std::string_view text;
 
-            if (argc >= args.size())
+    FormatArg(bool value) : kind(BOOLEAN), boolean(value) {}
+    FormatArg(char value) : kind(CHARACTER), character(value) {}
+    FormatArg(int value) : kind(INTEGER), integer(value) {}
+    FormatArg(long value) : kind(INTEGER), integer(value) {}
+    FormatArg(long long value) : kind(INTEGER), integer(value) {}
+    FormatArg(unsigned value) : kind(UNSIGNED), natural(value) {}
+    FormatArg(unsigned long value) : kind(UNSIGNED), natural(value) {}
+    FormatArg(unsigned long long value) : kind(UNSIGNED), natural(value) {}
+    FormatArg(float value) : kind(FLOATING), floating(value) {}
+    FormatArg(double value) : kind(FLOATING), floating(value) {}
+    FormatArg(const char* value) : kind(TEXT), integer(0), text(value) {}
+    FormatArg(const std::string& value) : kind(TEXT), integer(0), text(value) {}
+    FormatArg(std::string_view value) : kind(TEXT), integer(0), text(value) {}
+
+    void appendTo(std::string& output) const {
+        char buffer[32];
+
+        switch (kind) {
+            case INTEGER:
+                output.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), integer).ptr);
+                break;
+            case UNSIGNED:
+                output.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), natural).ptr);
                 break;
+            case FLOATING:
+                output.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), floating).ptr);
+                break;
+            case CHARACTER:
+                output.push_back(character);
+                break;
+            case BOOLEAN:
+                output.append(boolean ? "true" : "false");
+                break;
+            case TEXT:
+                output.append(text);
+                break;
+        }
+    }
+
+    // Upper bound of the bytes appendTo() writes, used to size the output once
+    size_t estimate() const {
+        return kind == TEXT ? text.size() : 24;
+    }
+};
+
+template <typename T>
+constexpr FormatArg::Kind formatKind() {
+    using U = std::decay_t<T>;
+
+    if constexpr (std::is_same_v<U, bool>)
+        return FormatArg::BOOLEAN;
+    else if constexpr (std::is_same_v<U, char>)
+        return FormatArg::CHARACTER;
+    else if constexpr (std::is_integral_v<U> && std::is_unsigned_v<U>)
+        return FormatArg::UNSIGNED;
+    else if constexpr (std::is_integral_v<U>)
+        return FormatArg::INTEGER;
+    else if constexpr (std::is_floating_point_v<U>)
+        return FormatArg::FLOATING;
+    else
+        return FormatArg::TEXT;
+}
+
+// Specifier letter each argument kind is written with
+constexpr char formatSpecifier(FormatArg::Kind kind) {
+    switch (kind) {
+        case FormatArg::INTEGER:
+        case FormatArg::UNSIGNED: return 'i';
+        case FormatArg::FLOATING: return 'd';
+        case FormatArg::CHARACTER: return 'c';
+        case FormatArg::BOOLEAN: return 'b';
+        default: return 's';
+    }
+}
+
+// True when every specifier of `text` matches the kind of the argument in its position and
+// there are exactly as many specifiers as arguments
+template <typename... Args>
+constexpr bool formatMatches(std::string_view text) {
+    constexpr FormatArg::Kind kinds[] = { formatKind<Args>()..., FormatArg::TEXT };
+    size_t argc = 0;
+
+    for (size_t i = 0; i + 1 < text.size(); i++) {
+        if (text[i] != '%')
+            continue;
+
+        char specifier = text[++i];
+
+        if (specifier == '%')
+            continue;
 
-            switch (input[current + 1]) {
-                case 'd':
-                    {
-                        double _in = std::get<double>(args.at(argc));
-                        output.replace(current - 1, 2, std::to_string(_in));
-                        argc++;
-                    }
-                    break;
-                case 'i':
-                    {
-                        int _in = std::get<int>(args.at(argc));
-                        output.replace(current - 1, 2, std::to_string(_in));
-                        argc++;
-                    }
-                    break;
-                case 'c':
-                    {
-                        char _in = std::get<char>(args.at(argc));
-                        output.replace(current - 1, 2, std::string(1, _in));
-                        argc++;
-                    }
-                    break;
-                case 's':
-                    {
-                        try {
-                            const char* _in = std::get<const char*>(args.at(argc));
-                            output.replace(current - 1, 2, _in);
-                            argc++;
-                        }
-                        catch(...) {
-                            try {
-                                std::string _in = std::get<std::string>(args.at(argc));
-                                output.replace(current - 1, 2, _in);
-                                argc++;
-                            }
-                            catch(...) {}
-                        }
-                    }
-                    break;
-                case 'b':
-                    {
-                        bool _in = std::get<bool>(args.at(argc));
-                        output.replace(current - 1, 2, (_in ? "true" : "false"));
-                        argc++;
-                    }
-                    break;
-                default:
-                    break;
-            }
+        if (argc >= sizeof...(Args) || specifier != formatSpecifier(kinds[argc]))
+            return false;
+
+        argc++;
+    }
+
+    return argc == sizeof...(Args);
+}
+
+// Not constexpr on purpose: reaching it while checking a format string at compile time is the error
+inline void formatStringMismatch() {}
+
+template <typename T>
+struct FormatIdentity {
+    using type = T;
+};
+
+// Format string for format()/appendFormat(). With C++20 a literal is checked at compile time
+// against the argument types (%s text, %i integer, %d floating point, %c char, %b bool, %% for
+// a percent sign), the build compiles every translation unit once as C++20 for that. Strings
+// only known at runtime are accepted unchecked.
+template <typename... Args>
+struct FormatString {
+    std::string_view text;
+
+    template <size_t N>
+    GENESIS_CONSTEVAL FormatString(const char (&input)[N]) : text(input, N - 1) {
+#if defined(__cpp_consteval)
+        if (!formatMatches<Args...>(text))
+            formatStringMismatch();
+#endif
+    }
+
+    FormatString(std::string_view input) : text(input) {}
+    FormatString(const std::string& input) : text(input) {}
+};
+
+// Appends the formatted text to `output` in a single pass, growing it at most once. A specifier
+// without a matching argument is copied verbatim, arguments are always written as their own type.
+template <typename... Args>
+void appendFormat(std::string& output, FormatString<typename FormatIdentity<Args>::type...> input, const Args&... args) {
+    const FormatArg list[] = { FormatArg(args)..., FormatArg(std::string_view()) };
+    std::string_view text = input.text;
+
+    size_t needed = text.size();
+
+    for (size_t i = 0; i < sizeof...(Args); i++)
+        needed += list[i].estimate();
+
+    output.reserve(output.size() + needed);
+
+    size_t argc = 0, literal = 0;
+
+    for (size_t current = 0; current + 1 < text.size(); current++) {
+        if (text[current] != '%')
+            continue;
+
+        char specifier = text[current + 1];
+        bool known = specifier == 's' || specifier == 'i' || specifier == 'd' || specifier == 'c' || specifier == 'b';
+
+        if (specifier == '%') {
+            output.append(text.substr(literal, current + 1 - literal));
+        }
+        else if (known && argc < sizeof...(Args)) {
+            output.append(text.substr(literal, current - literal));
+            list[argc++].appendTo(output);
+        }
+        else {
+            continue;
         }
 
         current++;
+        literal = current + 1;
     }
 
+    output.append(text.substr(literal));
+}
+
+template <typename... Args>
+std::string format(FormatString<typename FormatIdentity<Args>::type...> input, const Args&... args) {
+    std::string output;
+    appendFormat<Args...>(output, input, args...);
+
     return output;
 }
 
@@ -0,0 +1,165 @@
+#ifndef SOURCE_BUFFER_GENESIS
+#define SOURCE_BUFFER_GENESIS
+
+#include "Source.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GENESIS_MMAP 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Owns the bytes of one input for the whole compile. Regular files are memory-mapped,
+// anything else (pipes, stdin, sockets) is read once into a heap buffer. Tokens refer to
+// their lexeme through a std::string_view into this buffer, so it has to outlive the
+// Lexer, the Parser and every Statement built from them.
+class SourceBuffer {
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string owned;
+
+    void release() {
+#ifdef GENESIS_MMAP
+        if (mapped)
+            munmap(const_cast<char*>(data), length);
+#endif
+        data = nullptr;
+        length = 0;
+        mapped = false;
+        owned.clear();
+    }
+
+    void adopt(std::string text) {
+        owned = std::move(text);
+        data = owned.data();
+        length = owned.size();
+        mapped = false;
+    }
+
+#ifdef GENESIS_MMAP
+    bool readDescriptor(int descriptor) {
+        std::string text;
+        char chunk[1 << 16];
+
+        while (true) {
+            ssize_t count = ::read(descriptor, chunk, sizeof(chunk));
+
+            if (count == 0)
+                break;
+
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            text.append(chunk, count);
+        }
+
+        adopt(std::move(text));
+        return true;
+    }
+#endif
+
+public:
+    SourceBuffer() = default;
+    SourceBuffer(std::string text) { adopt(std::move(text)); }
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    SourceBuffer(SourceBuffer&& other) noexcept { *this = std::move(other); }
+
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        release();
+
+        if (other.mapped) {
+            data = other.data;
+            length = other.length;
+            mapped = true;
+        }
+        else {
+            adopt(std::move(other.owned));
+        }
+
+        other.data = nullptr;
+        other.length = 0;
+        other.mapped = false;
+
+        return *this;
+    }
+
+    ~SourceBuffer() { release(); }
+
+    // Loads the file at `path`, "-" reads standard input. Returns false if the input could not be opened or read.
+    bool open(const char* path) {
+        release();
+
+#ifdef GENESIS_MMAP
+        if (std::string_view(path) == "-")
+            return readDescriptor(STDIN_FILENO);
+
+        int descriptor = ::open(path, O_RDONLY);
+
+        if (descriptor < 0)
+            return false;
+
+        struct stat info;
+        bool success = false;
+
+        if (fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+            if (region != MAP_FAILED) {
+                madvise(region, info.st_size, MADV_SEQUENTIAL);
+
+                data = static_cast<const char*>(region);
+                length = info.st_size;
+                mapped = true;
+                success = true;
+            }
+        }
+
+        // Empty files, pipes, devices or a failed mapping all take the plain read path.
+        if (!success)
+            success = readDescriptor(descriptor);
+
+        ::close(descriptor);
+        return success;
+#else
+        std::ifstream inputFile(path, std::ios::in | std::ios::binary);
+
+        if (!inputFile.is_open())
+            return false;
+
+        std::stringstream buffer;
+        buffer << inputFile.rdbuf();
+
+        adopt(buffer.str());
+        return true;
+#endif
+    }
+
+    std::string_view view() const {
+        return std::string_view(data ? data : "", length);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool isMapped() const {
+        return mapped;
+    }
+};
+
+#endif // SOURCE_BUFFER_GENESIS
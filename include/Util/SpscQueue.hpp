@@ -0,0 +1,139 @@
+#ifndef SPSC_QUEUE_GENESIS
+#define SPSC_QUEUE_GENESIS
+
+#include "Source.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Bounded lock-free ring between exactly one producer and one consumer thread. Elements are used
+// in place: the producer takes a free slot with acquire(), fills it and publishes it with push(),
+// the consumer reads the oldest one with front() and hands it back with pop(). A full ring makes
+// the producer wait and an empty one the consumer, first spinning and then asleep.
+//
+// Each index sits on its own cache line next to the owner's private copy of the other index, so
+// the shared line is only read when the copy says the ring is full (or empty). The top bit of an
+// index is a stop flag: close() marks the end of the input, cancel() tells the producer to give up
+// the next time it finds the ring full.
+template <typename T, size_t Capacity>
+class SpscQueue {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+
+    static constexpr size_t cacheLine = 64;
+    static constexpr uint64_t stopBit = uint64_t(1) << 63;
+    static constexpr int spins = 64;
+
+    // Written by the producer
+    alignas(cacheLine) std::atomic<uint64_t> tail { 0 };
+    uint64_t headCopy = 0;
+
+    // Written by the consumer
+    alignas(cacheLine) std::atomic<uint64_t> head { 0 };
+    uint64_t tailCopy = 0;
+
+    // Only used once a side has to sleep, which both sides share since rarely more than one sleeps
+    alignas(cacheLine) std::atomic<uint32_t> sleepers { 0 };
+    std::mutex sleepLock;
+    std::condition_variable awake;
+
+    alignas(cacheLine) T slots[Capacity];
+
+    template <typename Ready>
+    void waitUntil(Ready&& ready) {
+        for (int i = 0; i < spins; i++) {
+            if (ready())
+                return;
+
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        awake.wait(guard, ready);
+        sleepers.fetch_sub(1);
+    }
+
+    // Pairs with the fence in waitUntil(): either the sleeper sees the new index or this sees the sleeper
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (sleepers.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            awake.notify_all();
+        }
+    }
+
+public:
+    // Producer: the next free slot, waits while the ring is full. Null once the consumer cancelled.
+    T* acquire() {
+        uint64_t at = tail.load(std::memory_order_relaxed);
+
+        if (at - headCopy >= Capacity) {
+            uint64_t observed = 0;
+
+            waitUntil([&]() {
+                observed = head.load(std::memory_order_acquire);
+                return (observed & stopBit) || at - observed < Capacity;
+            });
+
+            if (observed & stopBit)
+                return nullptr;
+
+            headCopy = observed;
+        }
+
+        return &slots[at & (Capacity - 1)];
+    }
+
+    // Producer: publishes the slot handed out by acquire()
+    void push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wake();
+    }
+
+    // Producer: nothing more will be pushed
+    void close() {
+        tail.fetch_or(stopBit, std::memory_order_release);
+        wake();
+    }
+
+    // Consumer: the oldest published slot, waits while the ring is empty. Null once it is empty and closed.
+    T* front() {
+        uint64_t at = head.load(std::memory_order_relaxed) & ~stopBit;
+
+        if (at == tailCopy) {
+            uint64_t observed = 0;
+
+            waitUntil([&]() {
+                observed = tail.load(std::memory_order_acquire);
+                return (observed & stopBit) || observed != at;
+            });
+
+            tailCopy = observed & ~stopBit;
+
+            if (tailCopy == at)
+                return nullptr;
+        }
+
+        return &slots[at & (Capacity - 1)];
+    }
+
+    // Consumer: hands the slot returned by front() back to the producer
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wake();
+    }
+
+    // Consumer: stops the producer, which sees null from acquire() once it runs out of room
+    void cancel() {
+        head.fetch_or(stopBit, std::memory_order_release);
+        wake();
+    }
+};
+
+#endif // SPSC_QUEUE_GENESIS
@@ -0,0 +1,271 @@
+#ifndef STATS_GENESIS
+#define STATS_GENESIS
+
+#include "Source.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Phase timing and counters behind --stats, --stats-json and --trace.
+//
+// Every phase of a compile (load, lex, parse, dump, ...) is bracketed with GENESIS_PHASE and
+// GENESIS_PHASE_END, counters are attached with GENESIS_PHASE_COUNT. A phase records its wall
+// time, the work it did and the heap allocations made on its thread, as counted by the operator
+// new of the executable (see src/Genesis.cpp). Phases are only recorded once Stats::collector()
+// was enabled at runtime, otherwise a phase costs a branch. Define GENESIS_NO_STATS to compile
+// all of it out: the macros then expand to nothing and their arguments are never evaluated.
+namespace Stats {
+    // Bumped by the executable's operator new, per thread so phases on different workers stay apart
+    inline thread_local uint64_t allocations = 0;
+    inline thread_local uint64_t allocatedBytes = 0;
+
+    inline long peakResidentKilobytes() {
+#if defined(__unix__) || defined(__APPLE__)
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    // Small stable id of the calling thread, for the trace viewer
+    inline uint32_t threadIndex() {
+        static std::atomic<uint32_t> next { 0 };
+        thread_local uint32_t index = next++;
+
+        return index;
+    }
+
+    inline void appendJsonString(std::string& json, std::string_view text) {
+        json += '"';
+
+        for (char c : text) {
+            switch (c) {
+                case '"': json += "\\\""; break;
+                case '\\': json += "\\\\"; break;
+                case '\n': json += "\\n"; break;
+                case '\t': json += "\\t"; break;
+                case '\r': json += "\\r"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        appendFormat(json, "\\u00%c%c", "0123456789abcdef"[c >> 4], "0123456789abcdef"[c & 15]);
+                    else
+                        json += c;
+            }
+        }
+
+        json += '"';
+    }
+
+    struct Record {
+        const char* phase;
+        std::string file;
+        uint32_t thread = 0;
+        int64_t start = 0, duration = 0;   // nanoseconds since the collector was created
+        uint64_t bytes = 0, tokens = 0, nodes = 0;
+        uint64_t allocations = 0, allocatedBytes = 0;
+        long peakKilobytes = 0;
+    };
+
+    class Collector {
+    private:
+        std::mutex lock;
+        std::vector<Record> records;
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        std::atomic<bool> active { false };
+
+        struct Total {
+            uint64_t count = 0, duration = 0, bytes = 0, tokens = 0, nodes = 0, allocations = 0, allocatedBytes = 0;
+        };
+
+        // Per phase, in order of first appearance
+        std::vector<std::pair<const char*, Total>> totals() {
+            std::vector<std::pair<const char*, Total>> result;
+
+            for (auto& record : records) {
+                auto found = std::find_if(result.begin(), result.end(), [&](auto& entry) { return std::string_view(entry.first) == record.phase; });
+
+                if (found == result.end()) {
+                    result.push_back({record.phase, Total {}});
+                    found = result.end() - 1;
+                }
+
+                Total& total = found->second;
+                total.count++;
+                total.duration += record.duration;
+                total.bytes += record.bytes;
+                total.tokens += record.tokens;
+                total.nodes += record.nodes;
+                total.allocations += record.allocations;
+                total.allocatedBytes += record.allocatedBytes;
+            }
+
+            return result;
+        }
+
+    public:
+        void enable() {
+            active = true;
+        }
+
+        // Forgets every record and stops recording, e.g. between the requests of a server
+        void reset() {
+            std::lock_guard<std::mutex> guard(lock);
+            records.clear();
+            active = false;
+        }
+
+        bool enabled() const {
+            return active.load(std::memory_order_relaxed);
+        }
+
+        int64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+        }
+
+        void add(Record record) {
+            std::lock_guard<std::mutex> guard(lock);
+            records.push_back(std::move(record));
+        }
+
+        // Human readable table, one line per phase
+        std::string summary() {
+            std::lock_guard<std::mutex> guard(lock);
+            std::string text = ">> Stats:\n";
+
+            for (auto& [phase, total] : totals()) {
+                double milliseconds = total.duration / 1e6;
+
+                appendFormat(text, "%s: %i runs, %d ms, %i bytes, %i tokens, %i nodes, %i allocations (%i bytes)",
+                    phase, total.count, milliseconds, total.bytes, total.tokens, total.nodes, total.allocations, total.allocatedBytes);
+
+                if (total.bytes && total.duration)
+                    appendFormat(text, ", %d MB/s", total.bytes / (1024.0 * 1024.0) / (total.duration / 1e9));
+
+                text += '\n';
+            }
+
+            appendFormat(text, "peak RSS: %i KB\n", peakResidentKilobytes());
+            return text;
+        }
+
+        std::string json() {
+            std::lock_guard<std::mutex> guard(lock);
+            std::string text = "{\n  \"phases\": {\n";
+            auto phases = totals();
+
+            for (size_t i = 0; i < phases.size(); i++) {
+                auto& total = phases[i].second;
+
+                appendFormat(text, "    \"%s\": { \"runs\": %i, \"seconds\": %d, \"bytes\": %i, \"tokens\": %i, \"nodes\": %i, \"allocations\": %i, \"allocated_bytes\": %i }%s\n",
+                    phases[i].first, total.count, total.duration / 1e9, total.bytes, total.tokens, total.nodes,
+                    total.allocations, total.allocatedBytes, i + 1 < phases.size() ? "," : "");
+            }
+
+            text += "  },\n  \"records\": [\n";
+
+            for (size_t i = 0; i < records.size(); i++) {
+                auto& record = records[i];
+
+                appendFormat(text, "    { \"phase\": \"%s\", \"file\": ", record.phase);
+                appendJsonString(text, record.file);
+                appendFormat(text, ", \"thread\": %i, \"start_seconds\": %d, \"seconds\": %d, \"bytes\": %i, \"tokens\": %i, \"nodes\": %i, \"allocations\": %i, \"allocated_bytes\": %i, \"peak_rss_kb\": %i }%s\n",
+                    record.thread, record.start / 1e9, record.duration / 1e9, record.bytes, record.tokens, record.nodes,
+                    record.allocations, record.allocatedBytes, record.peakKilobytes, i + 1 < records.size() ? "," : "");
+            }
+
+            appendFormat(text, "  ],\n  \"peak_rss_kb\": %i\n}\n", peakResidentKilobytes());
+            return text;
+        }
+
+        // Chrome trace-event format, loads in chrome://tracing and Perfetto
+        std::string trace() {
+            std::lock_guard<std::mutex> guard(lock);
+            std::string text = "{\"traceEvents\":[\n";
+
+            for (size_t i = 0; i < records.size(); i++) {
+                auto& record = records[i];
+
+                appendFormat(text, "{\"name\":\"%s\",\"cat\":\"genesis\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%d,\"dur\":%d,\"args\":{\"file\":",
+                    record.phase, record.thread, record.start / 1e3, record.duration / 1e3);
+                appendJsonString(text, record.file);
+                appendFormat(text, ",\"bytes\":%i,\"tokens\":%i,\"nodes\":%i,\"allocations\":%i}}%s\n",
+                    record.bytes, record.tokens, record.nodes, record.allocations, i + 1 < records.size() ? "," : "");
+            }
+
+            text += "],\"displayTimeUnit\":\"ms\"}\n";
+            return text;
+        }
+    };
+
+    inline Collector& collector() {
+        static Collector instance;
+        return instance;
+    }
+
+    // One timed phase, recorded by end() or when it goes out of scope (early returns)
+    class Phase {
+    private:
+        Record record;
+        bool running = false;
+
+    public:
+        uint64_t bytes = 0, tokens = 0, nodes = 0;
+
+        Phase(const char* phase, const std::string& file) {
+            if (!collector().enabled())
+                return;
+
+            record.phase = phase;
+            record.file = file;
+            record.thread = threadIndex();
+            record.allocations = allocations;
+            record.allocatedBytes = allocatedBytes;
+            record.start = collector().now();
+            running = true;
+        }
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+        ~Phase() { end(); }
+
+        void end() {
+            if (!running)
+                return;
+
+            running = false;
+            record.duration = collector().now() - record.start;
+            record.allocations = allocations - record.allocations;
+            record.allocatedBytes = allocatedBytes - record.allocatedBytes;
+            record.bytes = bytes;
+            record.tokens = tokens;
+            record.nodes = nodes;
+            record.peakKilobytes = peakResidentKilobytes();
+
+            collector().add(std::move(record));
+        }
+    };
+}
+
+#ifndef GENESIS_NO_STATS
+#define GENESIS_PHASE(handle, name, file) Stats::Phase handle(name, file)
+#define GENESIS_PHASE_COUNT(handle, counter, value) (handle.counter = (value))
+#define GENESIS_PHASE_END(handle) handle.end()
+#else
+#define GENESIS_PHASE(handle, name, file) ((void)0)
+#define GENESIS_PHASE_COUNT(handle, counter, value) ((void)0)
+#define GENESIS_PHASE_END(handle) ((void)0)
+#endif
+
+#endif // STATS_GENESIS
@@ -0,0 +1,199 @@
+#ifndef SYMBOLS_GENESIS
+#define SYMBOLS_GENESIS
+
+#include "Arena.hpp"
+#include "Hash.hpp"
+#include <array>
+#include <mutex>
+
+// 32-bit id of an interned lexeme, equal ids mean equal text as long as both came from the same
+// table. 0 is never handed out and marks a token that was not interned.
+using Symbol = uint32_t;
+
+constexpr Symbol noSymbol = 0;
+
+// Maps every distinct lexeme to one Symbol, so later passes compare and hash names as integers.
+// The hash is passed in so that callers which already have it (SymbolCache) never hash twice.
+class SymbolInterner {
+public:
+    virtual ~SymbolInterner() = default;
+
+    // noSymbol once the table is full, callers then fall back to comparing text
+    virtual Symbol intern(std::string_view text, uint64_t hash) = 0;
+    virtual std::string_view name(Symbol symbol) = 0;
+
+    Symbol intern(std::string_view text) {
+        return intern(text, hashBytes(text));
+    }
+};
+
+// Single-threaded interner: names are copied into an arena once, an open-addressed table of
+// symbols (linear probing, at most half full) finds them again by hash.
+class SymbolTable : public SymbolInterner {
+private:
+    Arena storage;
+    std::vector<std::string_view> names { std::string_view() };
+    std::vector<uint64_t> hashes { 0 };
+    std::vector<Symbol> slots = std::vector<Symbol>(64, noSymbol);
+    size_t limit;
+
+    void grow() {
+        std::vector<Symbol> larger(slots.size() * 2, noSymbol);
+        size_t mask = larger.size() - 1;
+
+        for (Symbol symbol = 1; symbol < names.size(); symbol++) {
+            size_t slot = hashes[symbol] & mask;
+
+            while (larger[slot] != noSymbol)
+                slot = (slot + 1) & mask;
+
+            larger[slot] = symbol;
+        }
+
+        slots = std::move(larger);
+    }
+
+public:
+    // `_limit` caps the number of symbols, the sharded table needs room for its shard bits
+    explicit SymbolTable(size_t _limit = UINT32_MAX) : storage(4096), limit(_limit) {}
+
+    using SymbolInterner::intern;
+
+    Symbol find(std::string_view text, uint64_t hash) const {
+        size_t mask = slots.size() - 1;
+
+        for (size_t slot = hash & mask; slots[slot] != noSymbol; slot = (slot + 1) & mask) {
+            Symbol symbol = slots[slot];
+
+            if (hashes[symbol] == hash && names[symbol] == text)
+                return symbol;
+        }
+
+        return noSymbol;
+    }
+
+    Symbol intern(std::string_view text, uint64_t hash) override {
+        size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+
+        for (; slots[slot] != noSymbol; slot = (slot + 1) & mask) {
+            Symbol symbol = slots[slot];
+
+            if (hashes[symbol] == hash && names[symbol] == text)
+                return symbol;
+        }
+
+        if (names.size() > limit)
+            return noSymbol;
+
+        Symbol symbol = static_cast<Symbol>(names.size());
+        names.push_back(storage.copy(text));
+        hashes.push_back(hash);
+        slots[slot] = symbol;
+
+        if (names.size() * 2 > slots.size())
+            grow();
+
+        return symbol;
+    }
+
+    std::string_view name(Symbol symbol) override {
+        return names[symbol];
+    }
+
+    size_t size() const {
+        return names.size() - 1;
+    }
+
+    size_t bytes() const {
+        return storage.bytesReserved() + names.capacity() * sizeof(std::string_view) + hashes.capacity() * sizeof(uint64_t) + slots.capacity() * sizeof(Symbol);
+    }
+};
+
+// Interner shared by the workers of a multi-file compile. The top bits of the hash pick one of 64
+// independently locked shards, the shard index is kept in the low bits of the symbol so name()
+// finds its way back. Put a SymbolCache in front of it to keep lock traffic off the hot path.
+class ConcurrentSymbolTable : public SymbolInterner {
+private:
+    static constexpr int shardBits = 6;
+
+    struct Shard {
+        std::mutex lock;
+        SymbolTable table { UINT32_MAX >> shardBits };
+    };
+
+    std::array<Shard, 1 << shardBits> shards;
+
+public:
+    using SymbolInterner::intern;
+
+    Symbol intern(std::string_view text, uint64_t hash) override {
+        size_t index = hash >> (64 - shardBits);
+        Shard& shard = shards[index];
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        Symbol local = shard.table.intern(text, hash);
+        return local == noSymbol ? noSymbol : (local << shardBits) | static_cast<Symbol>(index);
+    }
+
+    std::string_view name(Symbol symbol) override {
+        Shard& shard = shards[symbol & ((1 << shardBits) - 1)];
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        return shard.table.name(symbol >> shardBits);
+    }
+
+    size_t size() {
+        size_t total = 0;
+
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            total += shard.table.size();
+        }
+
+        return total;
+    }
+};
+
+// Direct-mapped memo of recent lookups in front of an interner, one per Lexer. A script reuses a
+// small vocabulary, so most lookups end here without probing (or locking) the shared table. The
+// cached views point at the text that was interned, which has to outlive the cache.
+class SymbolCache {
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        std::string_view text;
+        Symbol symbol = noSymbol;
+    };
+
+    static constexpr size_t capacity = 256;
+
+    SymbolInterner* table;
+    std::vector<Entry> entries;
+
+public:
+    SymbolCache(SymbolInterner* _table = nullptr) : table(_table) {
+        if (table)
+            entries.resize(capacity);
+    }
+
+    bool enabled() const {
+        return table != nullptr;
+    }
+
+    Symbol intern(std::string_view text) {
+        if (!table)
+            return noSymbol;
+
+        uint64_t hash = hashBytes(text);
+        Entry& entry = entries[hash & (capacity - 1)];
+
+        if (entry.symbol != noSymbol && entry.hash == hash && entry.text == text)
+            return entry.symbol;
+
+        entry = Entry { hash, text, table->intern(text, hash) };
+        return entry.symbol;
+    }
+};
+
+#endif // SYMBOLS_GENESIS
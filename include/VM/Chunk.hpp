@@ -0,0 +1,117 @@
+#ifndef CHUNK_GENESIS
+#define CHUNK_GENESIS
+
+#include "./Value.hpp"
+
+// Every instruction is one opcode byte, optionally followed by a little endian operand of 16 bits,
+// or of 24 bits for the _LONG forms used once a unit has more constants or globals than that.
+// The list is kept in one place so the VM's computed-goto table always matches the enum.
+#define GENESIS_OPCODES(X)  \
+    X(OP_CONSTANT)          /* [index] push constants[index] */ \
+    X(OP_NULL)              \
+    X(OP_TRUE)              \
+    X(OP_FALSE)             \
+    X(OP_POP)               \
+    X(OP_DEFINE_GLOBAL)     /* [slot] globals[slot] = pop */ \
+    X(OP_GET_GLOBAL)        /* [slot] push globals[slot] */ \
+    X(OP_CONSTANT_LONG)     /* [index:24] */ \
+    X(OP_DEFINE_GLOBAL_LONG) /* [slot:24] */ \
+    X(OP_GET_GLOBAL_LONG)   /* [slot:24] */ \
+    X(OP_ADD)               \
+    X(OP_SUBTRACT)          \
+    X(OP_MULTIPLY)          \
+    X(OP_DIVIDE)            \
+    X(OP_NEGATE)            \
+    X(OP_NOT)               \
+    X(OP_EQUAL)             \
+    X(OP_NOT_EQUAL)         \
+    X(OP_LESS)              \
+    X(OP_LESS_EQUAL)        \
+    X(OP_GREATER)           \
+    X(OP_GREATER_EQUAL)     \
+    X(OP_RETURN)            /* return pop */
+
+enum OpCode : uint8_t {
+#define GENESIS_OPCODE_ENUM(name) name,
+    GENESIS_OPCODES(GENESIS_OPCODE_ENUM)
+#undef GENESIS_OPCODE_ENUM
+    OP_COUNT
+};
+
+inline const char* opCodeName(uint8_t code) {
+    static const char* names[] = {
+#define GENESIS_OPCODE_NAME(name) #name,
+        GENESIS_OPCODES(GENESIS_OPCODE_NAME)
+#undef GENESIS_OPCODE_NAME
+    };
+
+    return code < OP_COUNT ? names[code] : "OP_UNKNOWN";
+}
+
+// Largest index a _LONG operand can hold
+constexpr uint32_t maxLongOperand = (uint32_t(1) << 24) - 1;
+
+// Bytes of operand following the opcode
+inline size_t opCodeOperandSize(uint8_t code) {
+    switch (code) {
+        case OP_CONSTANT:
+        case OP_DEFINE_GLOBAL:
+        case OP_GET_GLOBAL:
+            return 2;
+        case OP_CONSTANT_LONG:
+        case OP_DEFINE_GLOBAL_LONG:
+        case OP_GET_GLOBAL_LONG:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+// Compiled form of one compilation unit
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+    std::vector<std::string_view> globals;   // names, indexed by slot
+    int maxStack = 0;
+
+    void write(uint8_t byte) {
+        code.push_back(byte);
+    }
+
+    // `operand` has to fit the operand size of `op`
+    void write(OpCode op, uint32_t operand) {
+        code.push_back(op);
+
+        for (size_t i = 0; i < opCodeOperandSize(op); i++)
+            code.push_back(static_cast<uint8_t>(operand >> (8 * i)));
+    }
+
+    std::string disassemble() const {
+        std::string output;
+
+        for (size_t offset = 0; offset < code.size(); offset++) {
+            uint8_t op = code[offset];
+            output += std::to_string(offset) + " " + opCodeName(op);
+
+            if (size_t size = opCodeOperandSize(op)) {
+                uint32_t operand = 0;
+
+                for (size_t i = 0; i < size; i++)
+                    operand |= uint32_t(code[offset + 1 + i]) << (8 * i);
+
+                output += " " + std::to_string(operand);
+
+                if (op == OP_CONSTANT || op == OP_CONSTANT_LONG)
+                    output += " '" + constants[operand].toString() + "'";
+
+                offset += size;
+            }
+
+            output += "\n";
+        }
+
+        return output;
+    }
+};
+
+#endif // CHUNK_GENESIS
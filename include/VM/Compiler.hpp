@@ -0,0 +1,261 @@
+#ifndef COMPILER_GENESIS
+#define COMPILER_GENESIS
+
+#include "../AST/Traversal.hpp"
+#include "../AST/TreeCache.hpp"
+#include "./Chunk.hpp"
+
+struct CompilerException {
+    std::string message;
+
+    std::string what() { return message; }
+};
+
+// Lowers a parsed compilation unit to a Chunk. Expression statements leave their value on the
+// stack and get popped, except the last one which becomes the result of the chunk. Every node
+// emits after its operands, so statements are walked children first and each visit only emits
+// the node's own instruction, dispatched statically from the walk.
+//
+// Number and string constants are pooled, each distinct value (numbers by their bits, strings
+// by their text) takes one slot however often it appears. Constants and globals past the 16 bit
+// operand range switch to the _LONG instructions.
+class Compiler final : public Visit, public StaticVisit<Compiler> {
+private:
+    Chunk chunk;
+    TreeWalk walk;
+    std::unordered_map<std::string_view, uint32_t> globalSlots;
+    // Interned names skip hashing the text, the map by name stays the authority
+    std::unordered_map<Symbol, uint32_t> symbolSlots;
+    std::unordered_map<uint64_t, uint32_t> numberConstants;
+    std::unordered_map<std::string_view, uint32_t> stringConstants;
+    int depth = 0;
+
+    void adjustStack(int change) {
+        depth += change;
+        chunk.maxStack = std::max(chunk.maxStack, depth);
+    }
+
+    void emit(OpCode op, int stackChange) {
+        chunk.write(op);
+        adjustStack(stackChange);
+    }
+
+    // The short form of `op` while `operand` fits 16 bits, `longOp` after that
+    void emit(OpCode op, OpCode longOp, uint32_t operand, int stackChange) {
+        chunk.write(operand > UINT16_MAX ? longOp : op, operand);
+        adjustStack(stackChange);
+    }
+
+    uint32_t constant(Value value) {
+        if (chunk.constants.size() > maxLongOperand)
+            throw CompilerException { "Too many constants in one compilation unit..." };
+
+        chunk.constants.push_back(value);
+        return static_cast<uint32_t>(chunk.constants.size() - 1);
+    }
+
+    uint32_t numberConstant(double number) {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+
+        auto found = numberConstants.find(bits);
+
+        if (found != numberConstants.end())
+            return found->second;
+
+        uint32_t index = constant(Value::fromNumber(number));
+        numberConstants.emplace(bits, index);
+
+        return index;
+    }
+
+    uint32_t stringConstant(std::string_view text) {
+        auto found = stringConstants.find(text);
+
+        if (found != stringConstants.end())
+            return found->second;
+
+        uint32_t index = constant(Value::fromString(text));
+        stringConstants.emplace(text, index);
+
+        return index;
+    }
+
+    uint32_t globalSlot(const TokenInstance& token) {
+        if (token.symbol != noSymbol) {
+            auto found = symbolSlots.find(token.symbol);
+
+            if (found != symbolSlots.end())
+                return found->second;
+        }
+
+        uint32_t slot = globalSlot(token.value);
+
+        if (token.symbol != noSymbol)
+            symbolSlots.emplace(token.symbol, slot);
+
+        return slot;
+    }
+
+    uint32_t globalSlot(std::string_view name) {
+        auto found = globalSlots.find(name);
+
+        if (found != globalSlots.end())
+            return found->second;
+
+        if (chunk.globals.size() > maxLongOperand)
+            throw CompilerException { "Too many globals in one compilation unit..." };
+
+        uint32_t slot = static_cast<uint32_t>(chunk.globals.size());
+        chunk.globals.push_back(name);
+        globalSlots.emplace(name, slot);
+
+        return slot;
+    }
+
+    void literal(const TokenInstance& token) {
+        switch (token.token) {
+            case TokenClass::T_NUMBER:
+                emit(OP_CONSTANT, OP_CONSTANT_LONG, numberConstant(token.number()), 1);
+                break;
+            case TokenClass::T_STRING:
+                emit(OP_CONSTANT, OP_CONSTANT_LONG, stringConstant(token.value), 1);
+                break;
+            case TokenClass::T_TRUE:
+                emit(OP_TRUE, 1);
+                break;
+            case TokenClass::T_FALSE:
+                emit(OP_FALSE, 1);
+                break;
+            case TokenClass::T_NULL:
+                emit(OP_NULL, 1);
+                break;
+            case TokenClass::T_IDENTIFIER:
+                emit(OP_GET_GLOBAL, OP_GET_GLOBAL_LONG, globalSlot(token), 1);
+                break;
+            default:
+                throw CompilerException { format("Cannot compile literal '%s'...", token.value) };
+        }
+    }
+
+    void binary(const TokenInstance& op) {
+        switch (op.token) {
+            case TokenClass::T_PLUS: emit(OP_ADD, -1); break;
+            case TokenClass::T_MINUS: emit(OP_SUBTRACT, -1); break;
+            case TokenClass::T_STAR: emit(OP_MULTIPLY, -1); break;
+            case TokenClass::T_SLASH: emit(OP_DIVIDE, -1); break;
+            case TokenClass::T_EQUALEQUAL: emit(OP_EQUAL, -1); break;
+            case TokenClass::T_NOTEQUAL: emit(OP_NOT_EQUAL, -1); break;
+            case TokenClass::T_LESS: emit(OP_LESS, -1); break;
+            case TokenClass::T_LESSEQUAL: emit(OP_LESS_EQUAL, -1); break;
+            case TokenClass::T_GREATER: emit(OP_GREATER, -1); break;
+            case TokenClass::T_GREATEREQUAL: emit(OP_GREATER_EQUAL, -1); break;
+            default:
+                throw CompilerException { format("Cannot compile binary operator '%s'...", op.value) };
+        }
+    }
+
+    void unary(const TokenInstance& op) {
+        if (op.token == TokenClass::T_MINUS)
+            emit(OP_NEGATE, 0);
+        else if (op.token == TokenClass::T_BANG)
+            emit(OP_NOT, 0);
+        else
+            throw CompilerException { format("Cannot compile unary operator '%s'...", op.value) };
+    }
+
+    Chunk finish(bool hasResult) {
+        if (!hasResult)
+            emit(OP_NULL, 1);
+
+        emit(OP_RETURN, -1);
+        return std::move(chunk);
+    }
+
+public:
+    void visit(Expression&) {}
+
+    void visit(LiteralValue& node) {
+        literal(node.token);
+    }
+
+    void visit(Binary& node) {
+        binary(node.op);
+    }
+
+    void visit(Unary& node) {
+        unary(node.op);
+    }
+
+    void visit(Grouping&) {}
+
+    void visit(Let& node) {
+        emit(OP_DEFINE_GLOBAL, OP_DEFINE_GLOBAL_LONG, globalSlot(node.name), -1);
+    }
+
+    Chunk compile(const std::vector<Statement*>& statements) {
+        bool hasResult = false;
+
+        for (size_t i = 0; i < statements.size(); i++) {
+            int before = depth;
+            Statement* statement = statements[i];
+
+            walk.postOrder(statement, [&](Statement*& node) { apply(node); });
+            hasResult = depth > before;
+
+            if (hasResult && i + 1 < statements.size())
+                emit(OP_POP, -1);
+        }
+
+        return finish(hasResult);
+    }
+
+    // Compiles a cache image without building its tree: the records are stored in exactly the
+    // order compile() walks the statements, so they are emitted front to back. False when the
+    // records do not check out or would leave the stack short, which a well-formed image never does.
+    bool compile(const CachedTree& tree, Chunk& compiled) {
+        bool hasResult = false;
+        size_t next = 0;
+        NodeRecord record;
+
+        for (size_t i = 0; i < tree.statementCount(); i++) {
+            int before = depth;
+            uint32_t root = tree.statement(i);
+
+            for (; next <= root; next++) {
+                if (!tree.checkedNode(next, record))
+                    return false;
+
+                int operands = record.kind == CachedNodeKind::BINARY ? 2 : (record.kind == CachedNodeKind::LITERAL ? 0 : 1);
+
+                if (depth - before < operands)
+                    return false;
+
+                switch (record.kind) {
+                    case CachedNodeKind::LITERAL: literal(tree.nodeToken(record)); break;
+                    case CachedNodeKind::BINARY: binary(tree.nodeToken(record)); break;
+                    case CachedNodeKind::UNARY: unary(tree.nodeToken(record)); break;
+                    case CachedNodeKind::GROUPING: break;
+                    case CachedNodeKind::LET: emit(OP_DEFINE_GLOBAL, OP_DEFINE_GLOBAL_LONG, globalSlot(tree.nodeToken(record)), -1); break;
+                }
+            }
+
+            // One statement leaves at most its own value behind
+            if (next != size_t(root) + 1 || depth - before > 1)
+                return false;
+
+            hasResult = depth > before;
+
+            if (hasResult && i + 1 < tree.statementCount())
+                emit(OP_POP, -1);
+        }
+
+        if (next != tree.nodeCount())
+            return false;
+
+        compiled = finish(hasResult);
+        return true;
+    }
+};
+
+#endif // COMPILER_GENESIS
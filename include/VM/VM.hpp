@@ -0,0 +1,207 @@
+#ifndef VM_GENESIS
+#define VM_GENESIS
+
+#include "./Chunk.hpp"
+#include "../Util/Arena.hpp"
+
+// Define GENESIS_NO_COMPUTED_GOTO to force the portable switch loop
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(GENESIS_NO_COMPUTED_GOTO)
+#define GENESIS_COMPUTED_GOTO 1
+#endif
+
+struct RuntimeException {
+    std::string message;
+
+    std::string what() { return message; }
+};
+
+// Stack VM executing a Chunk. Dispatch uses a computed-goto table where the compiler supports it
+// (one indirect jump per instruction, each with its own branch history) and a switch otherwise.
+// Strings created while running live in `strings` and stay valid until the next run().
+class VM {
+private:
+    Arena strings;
+    std::vector<Value> stack;
+    std::vector<Value> globals;
+    std::vector<uint8_t> defined;
+
+    [[noreturn]] void error(std::string message) {
+        throw RuntimeException { message };
+    }
+
+    Value concatenate(const Value& left, const Value& right) {
+        size_t length = left.length + right.length;
+        char* data = static_cast<char*>(strings.allocate(length, 1));
+
+        std::copy(left.chars, left.chars + left.length, data);
+        std::copy(right.chars, right.chars + right.length, data + left.length);
+
+        return Value::fromString(std::string_view(data, length));
+    }
+
+public:
+    Value run(const Chunk& chunk) {
+        strings.release();
+        stack.resize(chunk.maxStack + 1);
+        globals.assign(chunk.globals.size(), Value::null());
+        defined.assign(chunk.globals.size(), 0);
+
+        const uint8_t* ip = chunk.code.data();
+        const Value* constants = chunk.constants.data();
+        Value* top = stack.data();   // one past the last pushed value
+
+#define VM_OPERAND() (ip += 2, static_cast<uint16_t>(ip[-2] | (ip[-1] << 8)))
+#define VM_LONG_OPERAND() (ip += 3, static_cast<uint32_t>(ip[-3] | (ip[-2] << 8) | (ip[-1] << 16)))
+
+#define VM_ARITHMETIC(op) \
+        { \
+            Value right = *--top; \
+            Value& left = top[-1]; \
+            if (!left.isNumber() || !right.isNumber()) \
+                error("Operands must be numbers..."); \
+            left = Value::fromNumber(left.number op right.number); \
+        }
+
+#define VM_COMPARISON(op) \
+        { \
+            Value right = *--top; \
+            Value& left = top[-1]; \
+            if (!left.isNumber() || !right.isNumber()) \
+                error("Operands must be numbers..."); \
+            left = Value::fromBool(left.number op right.number); \
+        }
+
+#ifdef GENESIS_COMPUTED_GOTO
+        static void* labels[] = {
+#define GENESIS_OPCODE_LABEL(name) &&L_##name,
+            GENESIS_OPCODES(GENESIS_OPCODE_LABEL)
+#undef GENESIS_OPCODE_LABEL
+        };
+
+#define VM_CASE(name) L_##name:
+#define VM_NEXT() goto *labels[*ip++]
+
+        VM_NEXT();
+#else
+#define VM_CASE(name) case name:
+#define VM_NEXT() continue
+
+        for (;;) switch (*ip++) {
+#endif
+        VM_CASE(OP_CONSTANT)
+            *top++ = constants[VM_OPERAND()];
+            VM_NEXT();
+        VM_CASE(OP_NULL)
+            *top++ = Value::null();
+            VM_NEXT();
+        VM_CASE(OP_TRUE)
+            *top++ = Value::fromBool(true);
+            VM_NEXT();
+        VM_CASE(OP_FALSE)
+            *top++ = Value::fromBool(false);
+            VM_NEXT();
+        VM_CASE(OP_POP)
+            top--;
+            VM_NEXT();
+        VM_CASE(OP_DEFINE_GLOBAL)
+        {
+            uint16_t slot = VM_OPERAND();
+            globals[slot] = *--top;
+            defined[slot] = 1;
+        }
+            VM_NEXT();
+        VM_CASE(OP_GET_GLOBAL)
+        {
+            uint16_t slot = VM_OPERAND();
+
+            if (!defined[slot])
+                error(format("Undefined variable '%s'...", chunk.globals[slot]));
+
+            *top++ = globals[slot];
+        }
+            VM_NEXT();
+        VM_CASE(OP_CONSTANT_LONG)
+            *top++ = constants[VM_LONG_OPERAND()];
+            VM_NEXT();
+        VM_CASE(OP_DEFINE_GLOBAL_LONG)
+        {
+            uint32_t slot = VM_LONG_OPERAND();
+            globals[slot] = *--top;
+            defined[slot] = 1;
+        }
+            VM_NEXT();
+        VM_CASE(OP_GET_GLOBAL_LONG)
+        {
+            uint32_t slot = VM_LONG_OPERAND();
+
+            if (!defined[slot])
+                error(format("Undefined variable '%s'...", chunk.globals[slot]));
+
+            *top++ = globals[slot];
+        }
+            VM_NEXT();
+        VM_CASE(OP_ADD)
+            if (top[-2].isString() && top[-1].isString()) {
+                top[-2] = concatenate(top[-2], top[-1]);
+                top--;
+                VM_NEXT();
+            }
+
+            VM_ARITHMETIC(+)
+            VM_NEXT();
+        VM_CASE(OP_SUBTRACT)
+            VM_ARITHMETIC(-)
+            VM_NEXT();
+        VM_CASE(OP_MULTIPLY)
+            VM_ARITHMETIC(*)
+            VM_NEXT();
+        VM_CASE(OP_DIVIDE)
+            VM_ARITHMETIC(/)
+            VM_NEXT();
+        VM_CASE(OP_NEGATE)
+            if (!top[-1].isNumber())
+                error("Operand must be a number...");
+
+            top[-1].number = -top[-1].number;
+            VM_NEXT();
+        VM_CASE(OP_NOT)
+            top[-1] = Value::fromBool(!top[-1].truthy());
+            VM_NEXT();
+        VM_CASE(OP_EQUAL)
+            top[-2] = Value::fromBool(top[-2].equals(top[-1]));
+            top--;
+            VM_NEXT();
+        VM_CASE(OP_NOT_EQUAL)
+            top[-2] = Value::fromBool(!top[-2].equals(top[-1]));
+            top--;
+            VM_NEXT();
+        VM_CASE(OP_LESS)
+            VM_COMPARISON(<)
+            VM_NEXT();
+        VM_CASE(OP_LESS_EQUAL)
+            VM_COMPARISON(<=)
+            VM_NEXT();
+        VM_CASE(OP_GREATER)
+            VM_COMPARISON(>)
+            VM_NEXT();
+        VM_CASE(OP_GREATER_EQUAL)
+            VM_COMPARISON(>=)
+            VM_NEXT();
+        VM_CASE(OP_RETURN)
+            return *--top;
+#ifndef GENESIS_COMPUTED_GOTO
+        default:
+            error("Unknown opcode...");
+        }
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_OPERAND
+#undef VM_LONG_OPERAND
+#undef VM_ARITHMETIC
+#undef VM_COMPARISON
+    }
+};
+
+#endif // VM_GENESIS
@@ -0,0 +1,104 @@
+#ifndef VALUE_GENESIS
+#define VALUE_GENESIS
+
+#include "../Util/Source.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+enum class ValueType : uint8_t {
+    V_NULL,
+    V_BOOL,
+    V_NUMBER,
+    V_STRING,
+};
+
+// 16 byte tagged value. Strings are non-owning, they point either into the SourceBuffer
+// (literals) or into the Arena of the VM that produced them.
+struct Value {
+    ValueType type;
+    uint32_t length;
+
+    union {
+        double number;
+        bool boolean;
+        const char* chars;
+    };
+
+    static Value null() {
+        Value value;
+        value.type = ValueType::V_NULL;
+        value.length = 0;
+        value.number = 0;
+        return value;
+    }
+
+    static Value fromBool(bool boolean) {
+        Value value = null();
+        value.type = ValueType::V_BOOL;
+        value.boolean = boolean;
+        return value;
+    }
+
+    static Value fromNumber(double number) {
+        Value value = null();
+        value.type = ValueType::V_NUMBER;
+        value.number = number;
+        return value;
+    }
+
+    static Value fromString(std::string_view text) {
+        Value value = null();
+        value.type = ValueType::V_STRING;
+        value.chars = text.data();
+        value.length = static_cast<uint32_t>(text.size());
+        return value;
+    }
+
+    bool isNumber() const { return type == ValueType::V_NUMBER; }
+    bool isString() const { return type == ValueType::V_STRING; }
+
+    std::string_view string() const {
+        return std::string_view(chars, length);
+    }
+
+    // null and false are the only falsy values
+    bool truthy() const {
+        return !(type == ValueType::V_NULL || (type == ValueType::V_BOOL && !boolean));
+    }
+
+    bool equals(const Value& other) const {
+        if (type != other.type)
+            return false;
+
+        switch (type) {
+            case ValueType::V_NULL: return true;
+            case ValueType::V_BOOL: return boolean == other.boolean;
+            case ValueType::V_NUMBER: return number == other.number;
+            case ValueType::V_STRING: return string() == other.string();
+        }
+
+        return false;
+    }
+
+    std::string toString() const {
+        switch (type) {
+            case ValueType::V_NULL: return "null";
+            case ValueType::V_BOOL: return boolean ? "true" : "false";
+            case ValueType::V_STRING: return std::string(string());
+            case ValueType::V_NUMBER:
+            {
+                // Shortest representation that reads back to the same double
+                char buffer[32];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+                return std::string(buffer, result.ptr);
+            }
+        }
+
+        return "";
+    }
+};
+
+static_assert(sizeof(Value) == 16, "Value is expected to stay two words wide");
+
+#endif // VALUE_GENESIS
@@ -1,90 +1,140 @@
-#include "../include/AST/Parser.hpp"
+#include "../include/Driver/Server.hpp"
 
-struct GPair {
-    bool success;
-    std::string response;
-};
+#ifndef GENESIS_NO_STATS
+// Counts heap allocations per thread for the --stats phases. Every replaceable form is defined,
+// so no allocation slips past the count and every delete matches the new it pairs with.
+namespace {
+    void* countedAllocate(size_t size, size_t alignment) noexcept {
+        Stats::allocations++;
+        Stats::allocatedBytes += size;
 
-GPair fetchContent(int count, char** argv) {
-    if (count <= 1) {
-        std::cerr
-            << ">> Genesis:\n"
-            << "No file path found or supplied to compiler...\n";
+        if (size == 0)
+            size = 1;
 
-        return {false, ""};
+        if (alignment <= alignof(std::max_align_t))
+            return std::malloc(size);
+
+        // aligned_alloc() wants a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
     }
 
-    const char *filePath = argv[1];
-    std::fstream inputFile;
+    void* countedAllocateOrThrow(size_t size, size_t alignment) {
+        if (void* memory = countedAllocate(size, alignment))
+            return memory;
 
-    inputFile.open(filePath, std::ios::in);
+        throw std::bad_alloc();
+    }
+}
 
-    if (!inputFile.is_open()) {
-        std::cerr
-            << ">> Genesis:\n"
-            << "Could not open file at path '" << filePath << "'...\n";
+void* operator new(size_t size) {
+    return countedAllocateOrThrow(size, 0);
+}
 
-        return {false, ""};
-    }
+void* operator new[](size_t size) {
+    return countedAllocateOrThrow(size, 0);
+}
 
-    std::stringstream buffer;
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
 
-    buffer << inputFile.rdbuf();
-    inputFile.close();
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return countedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
 
-    return {true, buffer.str()};
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
 }
 
-/*
-int main(int charc, char** argv) {
-    GPair sourceCode = fetchContent(charc, argv);
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
+}
 
-    if (!sourceCode.success)
-        return 1;
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
 
-    Lexer lexer(sourceCode.response);
-    std::vector<TokenInstance> tokens;
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
 
-    try {
-        tokens = lexer.compile();
-    }
-    catch(LexerException& e) {
-        std::cerr
-            << ">> GenesisException:\n"
-            << ">> Message: " << e.message << "\n"
-            << ">> Line: " << e.line << "\n";
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
 
-        return 1;
-    }
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
 
-    for (auto i : tokens) {
-        std::cout
-            << ">> Value: " << i.value << "\n";
-    }
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
 
-    Parser parser(tokens);
-    std::vector<std::shared_ptr<Statement>> statements;
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
 
-    try {
-        statements = parser.compile();
-    }
-    catch(ParserException& e) {
-        std::cerr
-            << ">> GenesisException:\n"
-            << ">> Message: " << e.message << "\n";
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
 
-        return 1;
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+#endif
+
+int main(int charc, char** argv) {
+    // Flags are documented on runGenesis(). --serve answers framed compile requests on stdin and
+    // stdout, --serve-socket [path] on a Unix socket (see Server.hpp and genesis_client).
+    std::vector<std::string> arguments(argv + 1, argv + charc);
+
+#ifdef GENESIS_SERVER
+    if (!arguments.empty() && arguments[0] == "--serve") {
+        CompileServer server;
+        server.serveStream(STDIN_FILENO, STDOUT_FILENO);
+
+        return 0;
     }
 
-    for (auto i : statements) {
-        std::cout
-            << i->toString() << "\n";
+    if (!arguments.empty() && arguments[0] == "--serve-socket") {
+        CompileServer server;
+        std::string error;
+
+        if (!server.serveSocket(arguments.size() > 1 ? arguments[1] : defaultServerSocket(), error)) {
+            std::cerr << ">> Genesis:\n" << error << "\n";
+            return 1;
+        }
+
+        return 0;
     }
+#endif
 
-    return 0;
-}
-*/
+    // Dumps go out in large chunks with plain writes, they can be far bigger than the inputs
+    OutputBuffer standardOutput(1), standardError(2);
 
-int main() {
-    std::cout << format("(%i %i)", {1, 2, 3}) << std::endl;
-}
\ No newline at end of file
+    return runGenesis(arguments, DriverOptions(), standardOutput, standardError);
+}
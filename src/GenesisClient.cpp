@@ -0,0 +1,80 @@
+#include "../include/Driver/Server.hpp"
+
+// Drop-in for the Genesis executable that has a running compile server (Genesis --serve-socket)
+// do the work: same arguments, same output, same exit code. Without a server it compiles in
+// process like Genesis would.
+//
+// genesis_client [--socket <path>] <Genesis arguments>...
+// genesis_client [--socket <path>] --ping | --shutdown
+int main(int charc, char** argv) {
+    std::vector<std::string> arguments(argv + 1, argv + charc);
+
+#ifdef GENESIS_SERVER
+    std::string socket = defaultServerSocket();
+
+    if (arguments.size() >= 2 && arguments[0] == "--socket") {
+        socket = arguments[1];
+        arguments.erase(arguments.begin(), arguments.begin() + 2);
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    int server = connectToServer(socket);
+    bool control = arguments.size() == 1 && (arguments[0] == "--ping" || arguments[0] == "--shutdown");
+    std::string request;
+
+    if (control)
+        Protocol::appendField(request, arguments[0] == "--ping" ? "ping" : "shutdown");
+    else {
+        SourceBuffer input;
+
+        // The server has no access to our stdin, so it travels with the request
+        if (std::find(arguments.begin(), arguments.end(), "-") != arguments.end() && !input.open("-")) {
+            std::cerr << ">> Genesis:\nCould not read standard input...\n";
+            return 1;
+        }
+
+        if (server < 0) {
+            OutputBuffer standardOutput(1), standardError(2);
+            std::string text(input.view());
+            DriverOptions options;
+            options.standardInput = &text;
+
+            return runGenesis(arguments, options, standardOutput, standardError);
+        }
+
+        std::error_code code;
+        Protocol::appendField(request, "compile");
+        Protocol::appendField(request, std::filesystem::current_path(code).string());
+        Protocol::appendField(request, input.view());
+
+        for (auto& argument : arguments)
+            Protocol::appendField(request, argument);
+    }
+
+    std::string response;
+
+    if (server < 0 || !Protocol::writeFrame(server, request) || !Protocol::readFrame(server, response)) {
+        std::cerr << ">> Genesis:\nNo compile server answered on '" << socket << "'...\n";
+        return 1;
+    }
+
+    ::close(server);
+    std::vector<std::string_view> fields = Protocol::fields(response);
+
+    if (fields.size() != 3) {
+        std::cerr << ">> Genesis:\nMalformed response from the compile server...\n";
+        return 1;
+    }
+
+    OutputBuffer standardOutput(1), standardError(2);
+    standardOutput.append(fields[1]);
+    standardOutput.flush();
+    standardError.append(fields[2]);
+    standardError.flush();
+
+    return std::atoi(std::string(fields[0]).c_str());
+#else
+    OutputBuffer standardOutput(1), standardError(2);
+    return runGenesis(arguments, DriverOptions(), standardOutput, standardError);
+#endif
+}
@@ -0,0 +1,118 @@
+#include "../include/AST/Parser.hpp"
+#include "../bench/SourceGenerator.hpp"
+#include <atomic>
+#include <cmath>
+
+// Fails (exit code 1) when parsing allocates per token. Large generated inputs are parsed from a
+// token vector and from a TokenStore, and every operator new made while parsing is counted. Arena
+// blocks are counted as well: they follow the bytes of nodes built, at most one per 4 MB, and are
+// reported but checked separately from the rest, which has to stay logarithmic in the token count
+// (the statement list growing geometrically, the parser's stacks growing with nesting once).
+
+std::atomic<size_t> heapAllocations { 0 };
+
+void* countedAllocate(size_t size, size_t alignment) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (size == 0)
+        size = 1;
+
+    if (alignment <= alignof(std::max_align_t))
+        return std::malloc(size);
+
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* countedAllocateOrThrow(size_t size, size_t alignment) {
+    if (void* memory = countedAllocate(size, alignment))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return countedAllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAllocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+
+struct ParseCount {
+    size_t tokens = 0, allocations = 0, blocks = 0;
+    bool ok = false;
+};
+
+template <typename Source>
+ParseCount countParse(Source& source, size_t tokens) {
+    Arena arena;
+    ParseCount count;
+
+    size_t before = heapAllocations.load();
+    Parser parser(source, arena);
+    count.ok = !parser.compile().empty() && parser.diagnostics().empty();
+    count.allocations = heapAllocations.load() - before;
+    count.blocks = arena.blockCount();
+    count.tokens = tokens;
+
+    return count;
+}
+
+// Allocations other than arena blocks a parse of `tokens` tokens may make
+size_t allowance(size_t tokens) {
+    return 2 * static_cast<size_t>(std::log2(std::max<size_t>(tokens, 2))) + 32;
+}
+
+bool check(const char* name, SourceShape shape, size_t megabytes) {
+    GeneratorOptions generator;
+    generator.shape = shape;
+    generator.bytes = megabytes << 20;
+
+    std::string source = SourceGenerator(generator).generate();
+    Lexer lexer(source);
+    std::vector<TokenInstance> tokens = lexer.compile();
+    TokenStore store = Lexer(source).compileStore();
+
+    TokenStoreReader reader(store);
+    ParseCount counts[] = { countParse(tokens, tokens.size()), countParse(reader, store.size()) };
+    const char* sources[] = { "vector", "store" };
+    bool passed = true;
+
+    for (int i = 0; i < 2; i++) {
+        ParseCount& count = counts[i];
+        size_t others = count.allocations - std::min(count.allocations, count.blocks);
+        bool ok = count.ok && others <= allowance(count.tokens);
+
+        std::cout << format("%s %s %i MB: %i tokens, %i allocations (%i arena blocks), %s\n",
+            name, sources[i], megabytes, count.tokens, count.allocations, count.blocks, ok ? "ok" : "FAILED");
+
+        passed = passed && ok;
+    }
+
+    return passed;
+}
+
+int main() {
+    bool passed = true;
+
+    for (size_t megabytes : { 1, 8 }) {
+        passed = check("mixed", SourceShape::MIXED, megabytes) && passed;
+        passed = check("deep", SourceShape::DEEP, megabytes) && passed;
+    }
+
+    return passed ? 0 : 1;
+}